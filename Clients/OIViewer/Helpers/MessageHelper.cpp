@@ -93,7 +93,7 @@ namespace OIV
         return ss.str();
     }
 
-    std::wstring MessageHelper::CreateImageInfoMessage(const OIVBaseImageSharedPtr& oivImage, const OIVBaseImageSharedPtr& rasterized, IMCodec::ImageCodec& imageCodec)
+    std::wstring MessageHelper::CreateImageInfoMessage(const OIVBaseImageSharedPtr& oivImage, const OIVBaseImageSharedPtr& rasterized, IMCodec::ImageCodec& imageCodec, size_t mipPyramidSizeInBytes)
     {
 
         using namespace std;
@@ -162,6 +162,9 @@ namespace OIV
         messageValues.emplace_back("Codec used", MessageFormatter::ValueObjectList{ {       pluginDescription   } });
 
 
+        if (mipPyramidSizeInBytes > 0)
+            messageValues.emplace_back("Mip pyramid size", MessageFormatter::ValueObjectList{ { UnitHelper::FormatUnit(mipPyramidSizeInBytes, UnitType::BinaryDataShort, 0, 0) } });
+
         auto uniqueValues = rasterized->GetNumUniqueColors();
         if (uniqueValues > -1)
             messageValues.emplace_back("Unique values", MessageFormatter::ValueObjectList{ {uniqueValues } });
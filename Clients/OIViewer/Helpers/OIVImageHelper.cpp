@@ -37,4 +37,47 @@ namespace OIV
             return image;
         }
     }
+
+    bool OIVImageHelper::IsConvertedWithoutNormalization(IMCodec::TexelFormat texelFormat)
+    {
+        switch (texelFormat)
+        {
+        case IMCodec::TexelFormat::I_R8_G8_B8_A8:
+        case IMCodec::TexelFormat::I_B8_G8_R8_A8:
+        case IMCodec::TexelFormat::I_A8_R8_G8_B8:
+        case IMCodec::TexelFormat::I_A8_B8_G8_R8:
+        case IMCodec::TexelFormat::I_R8_G8_B8:
+        case IMCodec::TexelFormat::I_B8_G8_R8:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    OIVBaseImageSharedPtr OIVImageHelper::ResampleRendererCompatibleImage(OIVBaseImageSharedPtr image, LLUtils::PointI32 targetSize, const OIV_RECT_I& targetRegion, OIV_Resample_Filter filter, bool useRainbow)
+    {
+        IMCodec::ImageSharedPtr resampled = ResampleRendererCompatibleImage(image->GetImage(), targetSize, targetRegion, filter, useRainbow);
+        return resampled != nullptr ? std::make_shared<OIVBaseImage>(ImageSource::GeneratedByLib, resampled) : nullptr;
+    }
+
+    IMCodec::ImageSharedPtr OIVImageHelper::ResampleRendererCompatibleImage(IMCodec::ImageSharedPtr image, LLUtils::PointI32 targetSize, const OIV_RECT_I& targetRegion, OIV_Resample_Filter filter, bool useRainbow
+        , const ResampleCancellation* cancellation)
+    {
+        // Normalizing only the resampled region would change the brightness with the viewport.
+        if (IsConvertedWithoutNormalization(image->GetTexelFormat()) == false)
+            return nullptr;
+
+        IMCodec::ImageSharedPtr resampled = ApiGlobal::sPictureRenderer->Resample(image, targetSize, filter, targetRegion, cancellation);
+        if (resampled == nullptr)
+            return nullptr;
+
+        if (resampled->GetTexelFormat() != IMCodec::TexelFormat::I_R8_G8_B8_A8)
+        {
+            resampled = IMUtil::ImageUtil::ConvertImageWithNormalization(resampled, IMCodec::TexelFormat::I_R8_G8_B8_A8, useRainbow);
+            if (resampled == nullptr)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to convert image");
+        }
+
+        return resampled;
+    }
 }
\ No newline at end of file
@@ -16,10 +16,24 @@ namespace OIV
         static OIVBaseImageSharedPtr ConvertImage(OIVBaseImageSharedPtr image, IMCodec::TexelFormat texelFormat, bool useRainbow);
 
         static OIVBaseImageSharedPtr GetRendererCompatibleImage(OIVBaseImageSharedPtr image, bool useRainbow);
+
+        //Returns true if converting the texel format to a render compatible image doesn't depend on the range of the image values,
+        // i.e. a conversion of the 8 bit color channels.
+        static bool IsConvertedWithoutNormalization(IMCodec::TexelFormat texelFormat);
+
+        //Resample the image in its own texel format and convert only the resampled image to a render compatible image,
+        // returns nullptr if the texel format can't be resampled or requires normalization, since the range of the resampled
+        // region differs from the range of the whole image.
+        static OIVBaseImageSharedPtr ResampleRendererCompatibleImage(OIVBaseImageSharedPtr image, LLUtils::PointI32 targetSize, const OIV_RECT_I& targetRegion, OIV_Resample_Filter filter, bool useRainbow);
+
+        //Same as above without creating a renderable image, may be called from any thread.
+        // Also returns nullptr if the resample was cancelled.
+        static IMCodec::ImageSharedPtr ResampleRendererCompatibleImage(IMCodec::ImageSharedPtr image, LLUtils::PointI32 targetSize, const OIV_RECT_I& targetRegion, OIV_Resample_Filter filter, bool useRainbow
+            , const ResampleCancellation* cancellation = nullptr);
      
-        static OIVBaseImageSharedPtr ResampleImage(OIVBaseImageSharedPtr image, LLUtils::PointI32 scale)
+        static OIVBaseImageSharedPtr ResampleImage(OIVBaseImageSharedPtr image, LLUtils::PointI32 scale, const OIV_RECT_I& targetRegion, OIV_Resample_Filter filter)
         {
-            auto resampled = ApiGlobal::sPictureRenderer->Resample(image->GetImage(), scale);
+            auto resampled = ApiGlobal::sPictureRenderer->Resample(image->GetImage(), scale, filter, targetRegion);
             if (resampled != nullptr)
             {
                 return std::make_shared<OIVBaseImage>(ImageSource::GeneratedByLib, resampled);
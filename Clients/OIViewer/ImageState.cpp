@@ -2,6 +2,7 @@
 #include "OIVCommands.h"
 #include "Helpers/OIVImageHelper.h"
 #include <ImageUtil/ImageUtil.h>
+#include <algorithm>
 
 namespace OIV
 {
@@ -36,6 +37,14 @@ namespace OIV
     {
         if (fDirtyStage <= requiredImageStage && fOpenedImage != nullptr)
         {
+            // Keep displaying the current stages while the new ones are processed in the background.
+            if (IsImageChainQueueable() == true)
+            {
+                if (fImageChainQueued == false)
+                    QueueImageChain();
+                return;
+            }
+
             ImageChainStage currentStage = fDirtyStage;
             ImageChainStage previousStage = static_cast<ImageChainStage>(std::max((int)currentStage - 1, 0));
 
@@ -74,11 +83,13 @@ namespace OIV
         if (fOpenedImage->GetImage()->GetItemType() != IMCodec::ImageItemType::Container)
             SetImageChainRoot(fOpenedImage);
         else
-            SetImageChainRoot(std::make_shared<OIVBaseImage>(ImageSource::GeneratedByLib, fOpenedImage->GetImage()->GetSubImage(0)));
+            SetImageChainRoot(std::make_shared<OIVBaseImage>(ImageSource::GeneratedByLib, fOpenedImage->GetSubImage(0)));
     }
 
     void ImageState::ClearAll()
     {
+        fResampleGeneration++;
+        CancelImageChain();
         fCurrentImageChain.Reset();
         fOpenedImage.reset();
     }
@@ -135,8 +146,267 @@ namespace OIV
     }
 
 
+    void ImageState::SetResampleCompletedCallback(ResampleCompletedCallback callback)
+    {
+        fResampleCompletedCallback = std::move(callback);
+        if (fResampleCompletedCallback != nullptr && fResampleWorker == nullptr)
+            fResampleWorker = std::make_unique<ThreadPool>(1);
+    }
+
+    void ImageState::SetImageChainCompletedCallback(ImageChainCompletedCallback callback)
+    {
+        fImageChainCompletedCallback = std::move(callback);
+        if (fImageChainCompletedCallback != nullptr && fImageChainWorker == nullptr)
+            fImageChainWorker = std::make_unique<ThreadPool>(1);
+    }
+
+    void ImageState::StopBackgroundProcessing()
+    {
+        StopBackgroundResampling();
+        CancelImageChain();
+        if (fImageChainWorker != nullptr)
+            fImageChainWorker->ClearPendingJobs();
+        fImageChainWorker.reset();
+        fImageChainCompletedCallback = nullptr;
+
+        // The pyramids are built by the library, which outlives the client of the callback.
+        if (ApiGlobal::sPictureRenderer != nullptr)
+            ApiGlobal::sPictureRenderer->CancelMipPyramidBuilds();
+        fMipPyramidReadyCallback = nullptr;
+    }
+
+    void ImageState::SetMipPyramidReadyCallback(std::function<void()> callback)
+    {
+        fMipPyramidReadyCallback = std::move(callback);
+    }
+
+    size_t ImageState::GetMipPyramidSizeInBytes() const
+    {
+        const auto& rasterized = fCurrentImageChain.Get(ImageChainStage::Rasterized);
+        return rasterized != nullptr ? ApiGlobal::sPictureRenderer->GetMipPyramidSizeInBytes(rasterized->GetImage()) : 0;
+    }
+
+    void ImageState::StopBackgroundResampling()
+    {
+        fResampleGeneration++;
+        if (fResampleWorker != nullptr)
+            fResampleWorker->ClearPendingJobs();
+        fResampleWorker.reset();
+        fResampleCompletedCallback = nullptr;
+    }
+
+    ImageState::ResampleSources ImageState::GetResampleSources(LLUtils::PointI32 targetSize) const
+    {
+        ResampleSources sources;
+        sources.deformed = fCurrentImageChain.Get(ImageChainStage::Deformed)->GetImage();
+        sources.rasterized = fCurrentImageChain.Get(ImageChainStage::Rasterized)->GetImage();
+        sources.mipLevel = ApiGlobal::sPictureRenderer->GetMipLevel(sources.rasterized, targetSize);
+        return sources;
+    }
+
+    IMCodec::ImageSharedPtr ImageState::ResampleRendererCompatibleImage(const ResampleSources& sources, LLUtils::PointI32 targetSize, const OIV_RECT_I& region
+        , OIV_Resample_Filter filter, bool useRainbow, const ResampleCancellation* cancellation)
+    {
+        // Start from the nearest larger level of the mip pyramid of the rasterized image once it's built.
+        if (sources.mipLevel != nullptr)
+            return ApiGlobal::sPictureRenderer->Resample(sources.mipLevel, targetSize, filter, region, cancellation);
+
+        // Downscale 8 bit color images before rasterizing, so only the downscaled texels are converted.
+        // Images that need normalization are resampled from the rasterized image, which was normalized with the range of the whole image.
+        IMCodec::ImageSharedPtr resampled = OIVImageHelper::ResampleRendererCompatibleImage(sources.deformed, targetSize, region, filter, useRainbow, cancellation);
+        if (resampled == nullptr && (cancellation == nullptr || cancellation->IsCancelled() == false))
+            resampled = ApiGlobal::sPictureRenderer->Resample(sources.rasterized, targetSize, filter, region, cancellation);
+        return resampled;
+    }
+
+    void ImageState::QueueResample(uint64_t generation, ResampleSources sources, LLUtils::PointI32 targetSize, OIV_RECT_I region)
+    {
+        const bool useRainbow = fUseRainbowNormalization;
+
+        fResampleWorker->Enqueue([this, generation, sources = std::move(sources), targetSize, region, useRainbow]()
+            {
+                // Zooming or panning further starts a new generation, which cancels this resample
+                // even when it's still waiting in the queue.
+                const ResampleCancellation cancellation{ &fResampleGeneration, generation };
+                ResampleResult result{ generation };
+                try
+                {
+                    result.image = ResampleRendererCompatibleImage(sources, targetSize, region, RF_Box, useRainbow, &cancellation);
+                }
+                catch (...)
+                {
+                    result.error = std::current_exception();
+                }
+
+                if (cancellation.IsCancelled() == false)
+                    fResampleCompletedCallback(std::move(result));
+            });
+    }
+
+    bool ImageState::OnResampleCompleted(const ResampleResult& result)
+    {
+        auto& resampledSlot = fCurrentImageChain.Get(ImageChainStage::Resampled);
+        // Drop results that were superseded by a newer resample or by turning resampling off.
+        if (result.generation != fResampleGeneration || resampledSlot == nullptr || fDirtyStage <= ImageChainStage::Resampled)
+            return false;
+
+        if (result.error != nullptr)
+            std::rethrow_exception(result.error);
+
+        if (result.image == nullptr)
+            return false;
+
+        auto resampled = std::make_shared<OIVBaseImage>(ImageSource::GeneratedByLib, result.image);
+        resampled->SetScale(LLUtils::PointF64::One);
+        resampledSlot->SetVisible(false);
+        UpdateImageParameters(resampled, true);
+        resampledSlot = resampled;
+        resampled->SetPosition(GetVisibleImagePosition());
+        return true;
+    }
+
+    // The deformed and rasterized stages are processed in the background only when they replace stages of the same source image,
+    // a new source image is processed right away since the layout of the window depends on it.
+    bool ImageState::IsImageChainQueueable() const
+    {
+        return fImageChainCompletedCallback != nullptr
+            && fDirtyStage > ImageChainStage::SourceImage && fDirtyStage <= ImageChainStage::Rasterized
+            && fCurrentImageChain.Get(ImageChainStage::Rasterized) != nullptr;
+    }
+
+    void ImageState::CancelImageChain()
+    {
+        fImageChainGeneration++;
+        fImageChainQueued = false;
+    }
+
+    void ImageState::ProcessImageChain(ImageChainResult& result, IMCodec::ImageSharedPtr input, IMUtil::AxisAlignedTransform transform
+        , bool useRainbow, const ResampleCancellation& cancellation)
+    {
+        result.deformed = input;
+        if (result.firstStage == ImageChainStage::Deformed
+            && (transform.rotation != IMUtil::AxisAlignedRotation::None || transform.flip != IMUtil::AxisAlignedFlip::None))
+        {
+            result.deformed = IMUtil::ImageUtil::Transform(transform, input);
+        }
+
+        if (cancellation.IsCancelled() == true)
+            return;
+
+        result.rasterized = result.deformed;
+        if (result.deformed->GetTexelFormat() != IMCodec::TexelFormat::I_R8_G8_B8_A8)
+        {
+            result.rasterized = IMUtil::ImageUtil::ConvertImageWithNormalization(result.deformed, IMCodec::TexelFormat::I_R8_G8_B8_A8, useRainbow);
+            if (result.rasterized == nullptr)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to convert image");
+        }
+    }
+
+    void ImageState::QueueImageChain()
+    {
+        const uint64_t generation = ++fImageChainGeneration;
+        const ImageChainStage firstStage = fDirtyStage;
+        const IMCodec::ImageSharedPtr input = fCurrentImageChain.Get(firstStage == ImageChainStage::Deformed
+            ? ImageChainStage::SourceImage : ImageChainStage::Deformed)->GetImage();
+        const IMUtil::AxisAlignedTransform transform = fTransform;
+        const bool useRainbow = fUseRainbowNormalization;
+        const std::shared_ptr<ImageChainJob> job = std::make_shared<ImageChainJob>();
+        fImageChainJob = job;
+        fImageChainQueued = true;
+
+        fImageChainWorker->Enqueue([this, job, generation, firstStage, input, transform, useRainbow]()
+            {
+                // Transforming again, toggling normalization or replacing the image starts a new generation.
+                const ResampleCancellation cancellation{ &fImageChainGeneration, generation };
+                ImageChainResult result{ generation, firstStage };
+                try
+                {
+                    ProcessImageChain(result, input, transform, useRainbow, cancellation);
+                }
+                catch (...)
+                {
+                    result.error = std::current_exception();
+                }
+
+                {
+                    std::lock_guard lock(job->mutex);
+                    job->result = result;
+                    job->finished = true;
+                }
+                job->finishedCondition.notify_all();
+
+                if (cancellation.IsCancelled() == false)
+                    fImageChainCompletedCallback(std::move(result));
+            });
+    }
+
+    void ImageState::WaitImageChain()
+    {
+        const std::shared_ptr<ImageChainJob> job = fImageChainJob;
+        ImageChainResult result;
+        {
+            std::unique_lock lock(job->mutex);
+            job->finishedCondition.wait(lock, [&job] { return job->finished; });
+            result = job->result;
+        }
+
+        // The message posted by the job is dropped once the chain is published here.
+        OnImageChainCompleted(result);
+    }
+
+    bool ImageState::OnImageChainCompleted(const ImageChainResult& result)
+    {
+        if (result.generation != fImageChainGeneration || fImageChainQueued == false)
+            return false;
+
+        fImageChainQueued = false;
+
+        if (result.error != nullptr)
+            std::rethrow_exception(result.error);
+
+        // Build the new stages before hiding the current ones, so they're swapped within a single frame.
+        const auto& source = fCurrentImageChain.Get(ImageChainStage::SourceImage);
+        OIVBaseImageSharedPtr deformed = fCurrentImageChain.Get(ImageChainStage::Deformed);
+        if (result.firstStage == ImageChainStage::Deformed)
+            deformed = result.deformed == source->GetImage() ? source : std::make_shared<OIVBaseImage>(ImageSource::GeneratedByLib, result.deformed);
+
+        OIVBaseImageSharedPtr rasterized = result.rasterized == deformed->GetImage() ? deformed
+            : std::make_shared<OIVBaseImage>(ImageSource::GeneratedByLib, result.rasterized);
+
+        for (ImageChainStage stage = ImageChainStage::Begin; stage < ImageChainStage::Count; stage = static_cast<ImageChainStage>(static_cast<int>(stage) + 1))
+        {
+            if (fCurrentImageChain.Get(stage) != nullptr)
+                fCurrentImageChain.Get(stage)->SetVisible(false);
+        }
+
+        fResampleGeneration++;
+        fCurrentImageChain.Get(ImageChainStage::Resampled).reset();
+        fCurrentImageChain.Get(ImageChainStage::Deformed) = deformed;
+        fCurrentImageChain.Get(ImageChainStage::Rasterized) = rasterized;
+        rasterized->SetScale(fScale);
+        UpdateImageParameters(rasterized, true);
+        ApiGlobal::sPictureRenderer->BuildMipPyramid(rasterized->GetImage(), fMipPyramidReadyCallback);
+
+        fDirtyStage = ImageChainStage::Resampled;
+        Refresh();
+        return true;
+    }
+
+    // Visible size of the stages being processed in the background.
+    LLUtils::PointF64 ImageState::GetQueuedImageChainSize() const
+    {
+        LLUtils::PointF64 size = static_cast<LLUtils::PointF64>(fCurrentImageChain.Get(ImageChainStage::SourceImage)->GetImage()->GetDimensions());
+        if (fTransform.rotation == IMUtil::AxisAlignedRotation::Rotate90CW || fTransform.rotation == IMUtil::AxisAlignedRotation::Rotate90CCW)
+            std::swap(size.x, size.y);
+        return size * GetScale();
+    }
+
     void ImageState::SetDirtyStage(ImageChainStage dirtyStage)
     {
+        // Results of a queued job no longer match the parameters of the deformed and rasterized stages.
+        if (dirtyStage <= ImageChainStage::Rasterized)
+            CancelImageChain();
+
         if (dirtyStage < fDirtyStage)
             fDirtyStage = dirtyStage;
     }
@@ -162,6 +432,7 @@ namespace OIV
                     if (rasterized != nullptr)
                         UpdateImageParameters(rasterized, true);
                     fCurrentImageChain.Get(ImageChainStage::Resampled).reset();
+                    fResampleGeneration++;
                 }
                 else if (fFinalProcessingStage == ImageChainStage::Resampled)
                 {
@@ -181,6 +452,8 @@ namespace OIV
         if (fScale != scale)
         {
             fScale = scale;
+            // Cancel the resample of the previous scale.
+            fResampleGeneration++;
             auto visibleImage = GetVisibleImage();
             if (visibleImage != nullptr)
             {
@@ -198,10 +471,51 @@ namespace OIV
         {
             fOffset = offset;
             auto visibleImage = GetVisibleImage();
-            visibleImage->SetPosition(fOffset.Round());
+            visibleImage->SetPosition(GetVisibleImagePosition().Round());
+
+            if (IsActuallyResampled() && IsVisibleRegionResampled() == false)
+                SetDirtyStage(ImageChainStage::Resampled);
         }
     }
 
+    void ImageState::SetClientSize(LLUtils::PointI32 clientSize)
+    {
+        if (fClientSize != clientSize)
+        {
+            fClientSize = clientSize;
+            if (IsActuallyResampled() && IsVisibleRegionResampled() == false)
+                SetDirtyStage(ImageChainStage::Resampled);
+        }
+    }
+
+    // The part of the resampled image visible in the client window extended by 'margin' on each side.
+    OIV_RECT_I ImageState::GetResampleRegion(LLUtils::PointI32 targetSize, LLUtils::PointI32 margin) const
+    {
+        if (fClientSize.x <= 0 || fClientSize.y <= 0)
+            return { 0, 0, targetSize.x, targetSize.y };
+
+        const LLUtils::PointI32 visibleStart = static_cast<LLUtils::PointI32>((LLUtils::PointF64::Zero - fOffset).Round());
+        return {
+              std::clamp(visibleStart.x - margin.x, 0, targetSize.x)
+            , std::clamp(visibleStart.y - margin.y, 0, targetSize.y)
+            , std::clamp(visibleStart.x + fClientSize.x + margin.x, 0, targetSize.x)
+            , std::clamp(visibleStart.y + fClientSize.y + margin.y, 0, targetSize.y)
+        };
+    }
+
+    bool ImageState::IsVisibleRegionResampled() const
+    {
+        const OIV_RECT_I visible = GetResampleRegion(fResampledSize, LLUtils::PointI32::Zero);
+        return visible.x0 >= fResampledRegion.x0 && visible.y0 >= fResampledRegion.y0
+            && visible.x1 <= fResampledRegion.x1 && visible.y1 <= fResampledRegion.y1;
+    }
+
+    LLUtils::PointF64 ImageState::GetVisibleImagePosition() const
+    {
+        // The resampled image holds only a region of the image.
+        return IsActuallyResampled() ? fOffset + LLUtils::PointF64(fResampledRegion.x0, fResampledRegion.y0) : fOffset;
+    }
+
     void ImageState::UpdateImageParameters(OIVBaseImageSharedPtr visibleImage, bool visible)
     {
         visibleImage->SetVisible(visible);
@@ -231,12 +545,15 @@ namespace OIV
     LLUtils::PointF64 ImageState::GetVisibleSize()
     {
         Refresh(fFinalProcessingStage);
+        if (fImageChainQueued == true)
+            return GetQueuedImageChainSize();
+
         auto visiblImage = GetVisibleImage();
         using namespace LLUtils;
         PointF64 visibleImageSize = static_cast<PointF64>(visiblImage->GetImage()->GetDimensions());
 
         //If resampled, scale is already embedded in the image size, else multiplty by scale.
-        return IsActuallyResampled() ? visibleImageSize : visibleImageSize * GetScale();
+        return IsActuallyResampled() ? static_cast<PointF64>(fResampledSize) : visibleImageSize * GetScale();
     }
 
     void ImageState::SetImageChainRoot(OIVBaseImageSharedPtr image)
@@ -260,6 +577,15 @@ namespace OIV
         return fCurrentImageChain.Get(imageStage);
     }
 
+    OIVBaseImageSharedPtr& ImageState::GetProcessedImage(ImageChainStage imageStage)
+    {
+        Refresh(imageStage);
+        if (fImageChainQueued == true)
+            WaitImageChain();
+
+        return fCurrentImageChain.Get(imageStage);
+    }
+
     ImageChain& ImageState::GetWorkingImageChain()
     {
         return fCurrentImageChain;
@@ -304,6 +630,7 @@ namespace OIV
             auto rasterized = OIVImageHelper::GetRendererCompatibleImage(inputImage, fUseRainbowNormalization);
             rasterized->SetScale(fScale);
             UpdateImageParameters(rasterized, true);
+            ApiGlobal::sPictureRenderer->BuildMipPyramid(rasterized->GetImage(), fMipPyramidReadyCallback);
             return rasterized;
         }
            break;
@@ -319,13 +646,33 @@ namespace OIV
             {
                 auto rasterized = fCurrentImageChain.Get(ImageChainStage::Rasterized);
                 LLUtils::PointF64 originalImageSize = static_cast<LLUtils::PointF64>(rasterized->GetImage()->GetDimensions());
-                auto resampled = OIVImageHelper::ResampleImage(rasterized, static_cast<LLUtils::PointI32>((originalImageSize * GetScale()).Round()));
+                const LLUtils::PointI32 targetSize = static_cast<LLUtils::PointI32>((originalImageSize * GetScale()).Round());
+                // Resample only the visible part of the image and a margin around it, so the cost follows the window size.
+                const LLUtils::PointI32 margin = static_cast<LLUtils::PointI32>((static_cast<LLUtils::PointF64>(fClientSize) * ResampleViewportMargin).Round());
+                const OIV_RECT_I region = GetResampleRegion(targetSize, margin);
+                if (region.x1 <= region.x0 || region.y1 <= region.y0)
+                    return nullptr; // Image is outside the window.
+
+                // In progressive mode a nearest neighbour preview is shown right away and the box filtered image
+                // replaces it once it's resampled in the background.
+                const bool progressive = fResampleCompletedCallback != nullptr;
+                const OIV_Resample_Filter filter = progressive ? RF_Nearest : RF_Box;
+                const uint64_t generation = ++fResampleGeneration;
+                const ResampleSources sources = GetResampleSources(targetSize);
+                auto resampled = std::make_shared<OIVBaseImage>(ImageSource::GeneratedByLib
+                    , ResampleRendererCompatibleImage(sources, targetSize, region, filter, fUseRainbowNormalization, nullptr));
                 //Resampled image is pixel perfect in relation to the client window, so no scale.
 
+                if (progressive)
+                    QueueResample(generation, sources, targetSize, region);
+
+                fResampledSize = targetSize;
+                fResampledRegion = region;
                 resampled->SetScale(LLUtils::PointF64::One);
                 inputImage->SetVisible(false);
 
                 UpdateImageParameters(resampled, true);
+                resampled->SetPosition(fOffset + LLUtils::PointF64(region.x0, region.y0));
                 return resampled;
             }
         }
@@ -1,13 +1,22 @@
 #pragma once
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include "OIVImage/OIVBaseImage.h"
 #include "OIVImage/OIVFileImage.h"
 #include <ImageUtil/AxisAlignedTransform.h>
+#include "../../oiv/Source/ThreadPool.h"
 
 namespace OIV
 {
     //TODO: adjust resampling conditions
     constexpr double ResampleScaleThreshold = 0.8;
+    // Part of the client size resampled beyond each edge of the window, panning inside the margin doesn't require resampling.
+    constexpr double ResampleViewportMargin = 0.5;
     enum class ImageChainStage
     {
           SourceImage = 0
@@ -30,8 +39,30 @@ namespace OIV
     };
 
 
+    // Full quality resample computed on a background thread.
+    struct ResampleResult
+    {
+        uint64_t generation;
+        IMCodec::ImageSharedPtr image;
+        std::exception_ptr error;
+    };
+
+    // Deformed and rasterized images computed on a background thread.
+    struct ImageChainResult
+    {
+        uint64_t generation;
+        ImageChainStage firstStage;
+        IMCodec::ImageSharedPtr deformed;
+        IMCodec::ImageSharedPtr rasterized;
+        std::exception_ptr error;
+    };
+
     class ImageState
     {
+    public:
+        using ResampleCompletedCallback = std::function<void(ResampleResult)>;
+        using ImageChainCompletedCallback = std::function<void(ImageChainResult)>;
+
     public:// const methods:
 
         OIVBaseImageSharedPtr GetOpenedImage() const { return fOpenedImage; }
@@ -43,15 +74,21 @@ namespace OIV
         LLUtils::PointF64       GetOffset() const { return fOffset; }
 
         bool GetResample() const;
+        size_t GetMipPyramidSizeInBytes() const;
 
         LLUtils::PointF64 GetVisibleSize();
         OIVBaseImageSharedPtr GetVisibleImage() const;
 
     public:// mutating methods:
         void SetImageChainRoot(OIVBaseImageSharedPtr image);
+        // The image of the stage currently displayed, while the chain is processed in the background it may still be the previous one.
         OIVBaseImageSharedPtr& GetImage(ImageChainStage imageStage);
+        // Same as GetImage, but waits for the chain being processed in the background and publishes it first,
+        // use for operations on the image content that must match the current transform and normalization.
+        OIVBaseImageSharedPtr& GetProcessedImage(ImageChainStage imageStage);
         void SetScale(LLUtils::PointF64 scale);
         void SetOffset(LLUtils::PointF64 offset);
+        void SetClientSize(LLUtils::PointI32 clientSize);
         void SetUseRainbowNormalization(bool val);
         void SetOpenedImage(const OIVBaseImageSharedPtr& image);
         void ClearAll();
@@ -59,6 +96,22 @@ namespace OIV
         void ResetUserState();
         void SetResample(bool resample);
         void Refresh();
+        // Enables progressive resampling - the resampled stage shows a nearest neighbour preview at once and the full quality image
+        // is resampled in the background. 'callback' is invoked on the background thread and should pass the result to OnResampleCompleted.
+        void SetResampleCompletedCallback(ResampleCompletedCallback callback);
+        // Swaps in the full quality image, returns true if it's still relevant and the image chain has changed.
+        bool OnResampleCompleted(const ResampleResult& result);
+        void StopBackgroundResampling();
+        // Enables background processing of the image chain - once the image is displayed, the deformed and rasterized stages
+        // are recomputed in the background while the previous stages stay visible. 'callback' is invoked on the background thread
+        // and should pass the result to OnImageChainCompleted.
+        void SetImageChainCompletedCallback(ImageChainCompletedCallback callback);
+        // Publishes the deformed and rasterized stages, returns true if they're still relevant and the image chain has changed.
+        bool OnImageChainCompleted(const ImageChainResult& result);
+        // Stops background resampling, image chain processing and mip pyramid builds, none of the callbacks is invoked once returned.
+        void StopBackgroundProcessing();
+        // 'callback' is invoked on a background thread once the mip pyramid of a rasterized image is built.
+        void SetMipPyramidReadyCallback(std::function<void()> callback);
 
     private: //methods 
 
@@ -66,8 +119,31 @@ namespace OIV
         OIVBaseImageSharedPtr ProcessStage(ImageChainStage stage, OIVBaseImageSharedPtr image);
         void Refresh(ImageChainStage requiredImageStage);
         void UpdateImageParameters(OIVBaseImageSharedPtr visibleImage, bool visible);
+        bool IsImageChainQueueable() const;
+        void QueueImageChain();
+        void WaitImageChain();
+        void CancelImageChain();
+        // Deform and rasterize 'input' starting at 'result.firstStage', may be called from any thread.
+        static void ProcessImageChain(ImageChainResult& result, IMCodec::ImageSharedPtr input, IMUtil::AxisAlignedTransform transform
+            , bool useRainbow, const ResampleCancellation& cancellation);
+        LLUtils::PointF64 GetQueuedImageChainSize() const;
 
         bool IsActuallyResampled() const;
+        OIV_RECT_I GetResampleRegion(LLUtils::PointI32 targetSize, LLUtils::PointI32 margin) const;
+        bool IsVisibleRegionResampled() const;
+        // Images of the chain a resample may start from.
+        struct ResampleSources
+        {
+            IMCodec::ImageSharedPtr mipLevel;
+            IMCodec::ImageSharedPtr deformed;
+            IMCodec::ImageSharedPtr rasterized;
+        };
+        ResampleSources GetResampleSources(LLUtils::PointI32 targetSize) const;
+        // Resample into a render compatible image, may be called from any thread.
+        static IMCodec::ImageSharedPtr ResampleRendererCompatibleImage(const ResampleSources& sources, LLUtils::PointI32 targetSize, const OIV_RECT_I& region
+            , OIV_Resample_Filter filter, bool useRainbow, const ResampleCancellation* cancellation);
+        void QueueResample(uint64_t generation, ResampleSources sources, LLUtils::PointI32 targetSize, OIV_RECT_I region);
+        LLUtils::PointF64 GetVisibleImagePosition() const;
         ImageChain& GetWorkingImageChain();
         const ImageChain& GetWorkingImageChain() const;
     private: // member fields
@@ -80,5 +156,28 @@ namespace OIV
         ImageChainStage fFinalProcessingStage = ImageChainStage::Rasterized;
         LLUtils::PointF64 fScale = LLUtils::PointF64::One;
         LLUtils::PointF64 fOffset = LLUtils::PointF64::Zero;
+        LLUtils::PointI32 fClientSize = LLUtils::PointI32::Zero;
+        // Full size of the resampled image and the part of it held by the Resampled stage.
+        LLUtils::PointI32 fResampledSize = LLUtils::PointI32::Zero;
+        OIV_RECT_I fResampledRegion{};
+        ResampleCompletedCallback fResampleCompletedCallback;
+        std::unique_ptr<ThreadPool> fResampleWorker;
+        // Incremented on each resample, results of older resamples are dropped.
+        std::atomic_uint64_t fResampleGeneration = 0;
+        std::function<void()> fMipPyramidReadyCallback;
+        ImageChainCompletedCallback fImageChainCompletedCallback;
+        std::unique_ptr<ThreadPool> fImageChainWorker;
+        // Incremented whenever the parameters of the deformed or rasterized stages change, results of older jobs are dropped.
+        std::atomic_uint64_t fImageChainGeneration = 0;
+        bool fImageChainQueued = false;
+        // Result of the queued job, kept so the main thread can wait for it instead of waiting for its message.
+        struct ImageChainJob
+        {
+            std::mutex mutex;
+            std::condition_variable finishedCondition;
+            bool finished = false;
+            ImageChainResult result;
+        };
+        std::shared_ptr<ImageChainJob> fImageChainJob;
     };
 }
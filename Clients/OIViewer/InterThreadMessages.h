@@ -8,7 +8,10 @@ namespace OIV
         AutoScroll,
         FirstFrameDisplayed,
         LoadFileExternally,
-        CountColors
+        CountColors,
+        ResampleCompleted,
+        MipPyramidReady,
+        ImageChainCompleted
     };
 
     struct CountColorsData
@@ -16,4 +19,8 @@ namespace OIV
         void* image;
         int64_t colorCount;
     };
+
+    struct MipPyramidReadyData
+    {
+    };
 }  // namespace OIV
\ No newline at end of file
@@ -446,7 +446,7 @@ namespace OIV
                     if (sv.empty() == false)
                         sv = sv.substr(1);
 
-                    auto rasterized = fImageState.GetImage(ImageChainStage::Rasterized)->GetImage();
+                    auto rasterized = fImageState.GetProcessedImage(ImageChainStage::Rasterized)->GetImage();
 
                     if (IMUtil::ImageUtil::HasAlphaChannelAndInUse(rasterized) == false)
                         rasterized = IMUtil::ImageUtil::Convert(
@@ -1084,6 +1084,8 @@ namespace OIV
         if (fCountingColorsThread.joinable())
             fCountingColorsThread.join();
 
+        fImageState.StopBackgroundProcessing();
+
         RemoveExceptionHandler();
     }
 
@@ -1105,7 +1107,7 @@ namespace OIV
 
         RegisterExceptionhandler();
 
-        OIV_CMD_RegisterCallbacks_Request request;
+        OIV_CMD_RegisterCallbacks_Request request = {};
 
         request.OnException = [](OIV_Exception_Args args, void* userPointer)
         {
@@ -1570,7 +1572,7 @@ namespace OIV
 
             for (uint16_t i = 0; i < numSubImages; i++)
             {
-                auto currentSubImage = mainImage->GetImage()->GetSubImage(i);
+                auto currentSubImage = mainImage->GetSubImage(i);
                 if (currentSubImage->GetTotalPixels() > largestSize)
                 {
                     largestSize = currentSubImage->GetTotalPixels();
@@ -1868,6 +1870,32 @@ namespace OIV
 
         fTimerNoActiveZoom.SetCallback(std::bind(&TestApp::DelayResamplingCallback, this));
 
+        // Full quality resampling is done in the background and handed back to the UI thread.
+        fImageState.SetResampleCompletedCallback(
+            [this](ResampleResult result)
+            {
+                fEventSync.AddData(static_cast<std::underlying_type_t<InterThreadMessages>>(
+                                       InterThreadMessages::ResampleCompleted),
+                                   std::move(result));
+            });
+
+        // Transformed and normalized images are processed in the background while the previous ones stay visible.
+        fImageState.SetImageChainCompletedCallback(
+            [this](ImageChainResult result)
+            {
+                fEventSync.AddData(static_cast<std::underlying_type_t<InterThreadMessages>>(
+                                       InterThreadMessages::ImageChainCompleted),
+                                   std::move(result));
+            });
+
+        fImageState.SetMipPyramidReadyCallback(
+            [this]()
+            {
+                fEventSync.AddData(static_cast<std::underlying_type_t<InterThreadMessages>>(
+                                       InterThreadMessages::MipPyramidReady),
+                                   MipPyramidReadyData{});
+            });
+
         fTimerNavigation.SetTargetWindow(fWindow.GetHandle());
         fTimerNavigation.SetCallback(
             [this]()
@@ -1901,7 +1929,7 @@ namespace OIV
         fSequencerTimer.SetCallback(
             [this]()
             {
-                auto currentImage = fImageState.GetOpenedImage()->GetImage()->GetSubImage(fCurrentFrame);
+                auto currentImage = fImageState.GetOpenedImage()->GetSubImage(fCurrentFrame);
                 fImageState.SetImageChainRoot(
                     std::make_shared<OIVBaseImage>(ImageSource::GeneratedByLib, currentImage));
                 auto nextFrame = (fCurrentFrame + 1) % fImageState.GetOpenedImage()->GetImage()->GetNumSubImages();
@@ -1956,18 +1984,18 @@ namespace OIV
     IMCodec::ImageSharedPtr TestApp::GetImageByIndex(int32_t index)
     {
         using namespace IMCodec;
-        auto openedImage = fImageState.GetOpenedImage()->GetImage();
+        auto openedImage = fImageState.GetOpenedImage();
 
-        const auto isMainAnActualImage = openedImage->GetItemType() != ImageItemType::Container;
+        const auto isMainAnActualImage = openedImage->GetImage()->GetItemType() != ImageItemType::Container;
 
         if (index == 0 && isMainAnActualImage)
         {
-            return openedImage;
+            return openedImage->GetImage();
         }
         else
         {
             const auto actualIndex = isMainAnActualImage == true ? std::max(0, index - 1) : index;
-            return openedImage->GetSubImage(actualIndex);
+            return openedImage->GetSubImage(static_cast<uint16_t>(actualIndex));
         }
     }
 
@@ -2933,6 +2961,18 @@ namespace OIV
         }
     }
 
+    void TestApp::OnResampleCompleted(const ResampleResult& resampleResult)
+    {
+        if (fImageState.OnResampleCompleted(resampleResult) == true)
+            fRefreshOperation.Queue();
+    }
+
+    void TestApp::OnImageChainCompleted(const ImageChainResult& imageChainResult)
+    {
+        if (fImageState.OnImageChainCompleted(imageChainResult) == true)
+            fRefreshOperation.Queue();
+    }
+
     void TestApp::OnMessageFromBackgroundThread(const EventData& sharedData)
     {
         if (sharedData.data.has_value() == false)
@@ -2966,6 +3006,17 @@ namespace OIV
                 LL_EXCEPTION_NOT_IMPLEMENT("First frame displayed not implemented");
             case InterThreadMessages::LoadFileExternally:
                 LL_EXCEPTION_NOT_IMPLEMENT("Load file externally not implemented");
+            case InterThreadMessages::ResampleCompleted:
+                OnResampleCompleted(std::any_cast<const ResampleResult&>(sharedData.data));
+                break;
+            case InterThreadMessages::MipPyramidReady:
+                // Show the memory used by the pyramid.
+                if (GetImageInfoVisible() == true)
+                    ShowImageInfo();
+                break;
+            case InterThreadMessages::ImageChainCompleted:
+                OnImageChainCompleted(std::any_cast<const ImageChainResult&>(sharedData.data));
+                break;
             default:
                 break;
         }
@@ -3125,6 +3176,8 @@ namespace OIV
     void TestApp::SetOffset(LLUtils::PointF64 offset, bool preserveOffsetLockState)
     {
         fImageState.SetOffset(ResolveOffset(offset));
+        // Resample again if the pan exposed parts of the image outside the resampled region.
+        fImageState.Refresh();
         fPreserveImageSpaceSelection.Queue();
         fRefreshOperation.Queue();
 
@@ -3195,7 +3248,7 @@ namespace OIV
                            : PointF64(0, 0);
             case ImageSizeType::Transformed:
                 return static_cast<PointF64>(
-                    fImageState.GetImage(ImageChainStage::Deformed)->GetImage()->GetDimensions());
+                    fImageState.GetProcessedImage(ImageChainStage::Deformed)->GetImage()->GetDimensions());
             case ImageSizeType::Visible:
                 return fImageState.GetVisibleSize();
 
@@ -3481,7 +3534,7 @@ namespace OIV
                       storageImageSpace.y >= storageImageSize.y))
                 {
                     std::wstring message = StringUtility::ConvertString<OIVString>(
-                        OIVHelper::ParseTexelValue(fImageState.GetImage(ImageChainStage::Deformed)->GetImage(),
+                        OIVHelper::ParseTexelValue(fImageState.GetProcessedImage(ImageChainStage::Deformed)->GetImage(),
                                                    static_cast<LLUtils::PointI32>(storageImageSpace)));
                     OIVString txt = LLUtils::StringUtility::ConvertString<OIVString>(message);
                     fVirtualStatusBar.SetText("texelValue", txt);
@@ -3515,8 +3568,10 @@ namespace OIV
             CmdSetClientSizeRequest req{static_cast<uint16_t>(size.cx), static_cast<uint16_t>(size.cy)};
 
             OIVCommands::ExecuteCommand(CMD_SetClientSize, &req, &NullCommand);
+            fImageState.SetClientSize({ static_cast<int32_t>(size.cx), static_cast<int32_t>(size.cy) });
             // UpdateCanvasSize();
             AutoPlaceImage();
+            RefreshImage();
             auto point = static_cast<LLUtils::PointI32>(fWindow.GetCanvasSize());
             fVirtualStatusBar.ClientSizeChanged(point);
 
@@ -3778,7 +3833,7 @@ namespace OIV
             {
                 LLUtils::RectI32 imageSpaceSelection = ClientToImageRounded(fSelectionRect.GetSelectionRect());
                 auto cropped = IMUtil::ImageUtil::CropImage(
-                    fImageState.GetImage(ImageChainStage::Rasterized)->GetImage(), imageSpaceSelection);
+                    fImageState.GetProcessedImage(ImageChainStage::Rasterized)->GetImage(), imageSpaceSelection);
 
                 if (cropped != nullptr)
                 {
@@ -3813,7 +3868,7 @@ namespace OIV
             else
             {
                 LLUtils::RectI32 imageRectInt = ClientToImageRounded(fSelectionRect.GetSelectionRect());
-                auto cropped = IMUtil::ImageUtil::CropImage(fImageState.GetImage(ImageChainStage::Deformed)->GetImage(),
+                auto cropped = IMUtil::ImageUtil::CropImage(fImageState.GetProcessedImage(ImageChainStage::Deformed)->GetImage(),
                                                             imageRectInt);
 
                 if (cropped != nullptr)
@@ -3839,7 +3894,7 @@ namespace OIV
         }
         else
         {
-            auto rasterized = fImageState.GetImage(ImageChainStage::Rasterized)->GetImage();
+            auto rasterized = fImageState.GetProcessedImage(ImageChainStage::Rasterized)->GetImage();
             if (fSelectionRect.GetSelectionRect().IsEmpty())
             {
                 result = OperationResult::NoSelection;
@@ -3858,7 +3913,7 @@ namespace OIV
                 {
                     SetClipboardImage(IMUtil::ImageUtil::GetSubImage(rasterized, subImageRect));
                     auto& texelInfo = IMCodec::GetTexelInfo(
-                        fImageState.GetImage(ImageChainStage::Rasterized)->GetImage()->GetOriginalTexelFormat());
+                        fImageState.GetProcessedImage(ImageChainStage::Rasterized)->GetImage()->GetOriginalTexelFormat());
                     bool hasOpacityChannel = false;
                     for (auto& channel : texelInfo.channles)
                         if (channel.semantic == IMCodec::ChannelSemantic::Opacity)
@@ -3870,7 +3925,7 @@ namespace OIV
                     const auto fillColor = hasOpacityChannel ? LLUtils::Color(0, 0, 0, 0)
                                                              : LLUtils::Color(0, 0, 0, 255);
                     auto colorFilled = IMUtil::ImageUtil::FillColor(
-                        fImageState.GetImage(ImageChainStage::Rasterized)->GetImage(), subImageRect, fillColor);
+                        fImageState.GetProcessedImage(ImageChainStage::Rasterized)->GetImage(), subImageRect, fillColor);
 
                     if (colorFilled != nullptr)
                     {
@@ -4282,7 +4337,7 @@ namespace OIV
 
             std::wstring imageInfoString = MessageHelper::CreateImageInfoMessage(
                 fImageState.GetOpenedImage(), fImageState.GetImage(ImageChainStage::SourceImage),
-                fImageLoader.GetImageCodec());
+                fImageLoader.GetImageCodec(), fImageState.GetMipPyramidSizeInBytes());
             OIVTextImage* imageInfoText = fLabelManager.GetOrCreateTextLabel("imageInfo");
 
             imageInfoText->SetText(imageInfoString);
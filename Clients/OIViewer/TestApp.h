@@ -313,6 +313,8 @@ namespace OIV
         LLUtils::PointI32 SnapToScreenSpaceImagePixels(LLUtils::PointI32 pointOnScreen);
         void OnMessageFromBackgroundThread(const EventData& sharedData);
         void OnCountingColorsCompleted(const CountColorsData& countColorsData);
+        void OnResampleCompleted(const ResampleResult& resampleResult);
+        void OnImageChainCompleted(const ImageChainResult& imageChainResult);
 
         using netsettings_Create_func = void (*)(GuiCreateParams*);
         using netsettings_SetVisible_func = void (*)(bool);
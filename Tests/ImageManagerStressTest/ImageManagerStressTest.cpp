@@ -0,0 +1,393 @@
+// Stress test of ImageManager under concurrent use, meant to be run under the thread and address sanitizers as well.
+// Writers add recreatable, child and lazily loaded child images and remove them one by one or in bulk while readers resolve them.
+// A small memory budget keeps evicting and recreating the images. Checks that:
+// - a live handle resolves to null or to its own image, never to the image of another slot.
+// - a removed handle, or the handle of a child of a removed image, never resolves again.
+// - a removed child is taken out of its parent's children.
+// - no image is left behind once all handles are removed.
+//
+// Usage: ImageManagerStressTest [--seed n] [--iterations n] [--readers n] [--writers n]
+
+#include <ImageManager.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace OIV;
+
+    struct Options
+    {
+        uint32_t seed = 1;
+        uint32_t iterations = 20000; // Per writer.
+        uint32_t readers = 6;
+        uint32_t writers = 3;
+    };
+
+    constexpr uint32_t ImageHeight = 16;
+    constexpr size_t SmallBudgetInBytes = 64 * 1024;
+    constexpr size_t LargeBudgetInBytes = 1024 * 1024;
+
+    // The width identifies the image, so a handle resolving to the image of another slot is detected.
+    IMCodec::ImageSharedPtr CreateImage(uint32_t width)
+    {
+        using namespace IMCodec;
+        ImageItemSharedPtr imageItem = std::make_shared<ImageItem>();
+        ImageDescriptor& desc = imageItem->descriptor;
+        desc.width = width;
+        desc.height = ImageHeight;
+        desc.rowPitchInBytes = width * 4;
+        desc.texelFormatDecompressed = TexelFormat::I_R8_G8_B8_A8;
+        desc.texelFormatStorage = TexelFormat::I_R8_G8_B8_A8;
+        imageItem->data.Allocate(desc.rowPitchInBytes * desc.height);
+        return std::make_shared<Image>(imageItem, ImageItemType::Unknown);
+    }
+
+    struct Entry
+    {
+        ImageHandle handle;
+        uint32_t width;
+        ImageHandle parent;
+    };
+
+    // Handles shared between the threads, 'stale' handles were removed and must never resolve again.
+    class Registry
+    {
+    public:
+        void AddLive(const Entry& entry)
+        {
+            std::lock_guard lock(fMutex);
+            fLive.push_back(entry);
+        }
+
+        bool PickLive(std::mt19937& random, Entry& entry, bool rootOnly = false)
+        {
+            std::lock_guard lock(fMutex);
+            if (fLive.empty())
+                return false;
+
+            entry = fLive[std::uniform_int_distribution<size_t>(0, fLive.size() - 1)(random)];
+            return rootOnly == false || entry.parent == ImageHandleNull;
+        }
+
+        bool TakeLive(std::mt19937& random, Entry& entry)
+        {
+            std::lock_guard lock(fMutex);
+            if (fLive.empty())
+                return false;
+
+            const size_t index = std::uniform_int_distribution<size_t>(0, fLive.size() - 1)(random);
+            entry = fLive[index];
+            fLive[index] = fLive.back();
+            fLive.pop_back();
+            return true;
+        }
+
+        // Marks the handle and the handles of its children as removed.
+        void MarkRemoved(ImageHandle handle)
+        {
+            std::lock_guard lock(fMutex);
+            fStale.push_back(handle);
+            for (size_t i = 0; i < fLive.size();)
+            {
+                if (fLive[i].parent == handle)
+                {
+                    fStale.push_back(fLive[i].handle);
+                    fLive[i] = fLive.back();
+                    fLive.pop_back();
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+
+        bool PickStale(std::mt19937& random, ImageHandle& handle)
+        {
+            std::lock_guard lock(fMutex);
+            if (fStale.empty())
+                return false;
+
+            handle = fStale[std::uniform_int_distribution<size_t>(0, fStale.size() - 1)(random)];
+            return true;
+        }
+
+        std::vector<Entry> TakeAllLive()
+        {
+            std::lock_guard lock(fMutex);
+            return std::move(fLive);
+        }
+
+    private:
+        std::mutex fMutex;
+        std::vector<Entry> fLive;
+        std::vector<ImageHandle> fStale;
+    };
+
+    class StressTest
+    {
+    public:
+        explicit StressTest(const Options& options) : fOptions(options)
+        {
+            fManager.SetBudget(SmallBudgetInBytes);
+        }
+
+        size_t Run()
+        {
+            std::vector<std::thread> threads;
+            for (uint32_t i = 0; i < fOptions.writers; i++)
+                threads.emplace_back([this, i] { Writer(i); });
+            for (uint32_t i = 0; i < fOptions.readers; i++)
+                threads.emplace_back([this, i] { Reader(fOptions.writers + i); });
+
+            for (std::thread& thread : threads)
+                thread.join();
+
+            CheckRemoveAll();
+            return fFailures;
+        }
+
+    private:
+        void Fail(const std::string& message)
+        {
+            if (fFailures++ < 10)
+            {
+                std::lock_guard lock(fOutputMutex);
+                std::cerr << message << '\n';
+            }
+        }
+
+        uint32_t RandomWidth(std::mt19937& random)
+        {
+            return std::uniform_int_distribution<uint32_t>(8, 64)(random);
+        }
+
+        void AddRoot(std::mt19937& random)
+        {
+            const uint32_t width = RandomWidth(random);
+            const ImageHandle handle = fManager.AddImage(CreateImage(width), [width] { return CreateImage(width); });
+            if (handle == ImageHandleNull)
+                Fail("AddImage failed");
+            else
+                fRegistry.AddLive({ handle, width, ImageHandleNull });
+        }
+
+        void AddChild(std::mt19937& random, bool lazy)
+        {
+            Entry parent;
+            if (fRegistry.PickLive(random, parent, true) == false)
+                return;
+
+            const uint32_t width = RandomWidth(random);
+            ImageHandle handle = ImageHandleNull;
+            try
+            {
+                // A lazy child holds its source and resolves its parent while loaded, like the oriented pages of a file.
+                const IMCodec::ImageSharedPtr source = lazy ? CreateImage(width) : nullptr;
+                handle = lazy ? fManager.AddLazyChildImage([this, parentHandle = parent.handle, width, source]
+                    {
+                        return fManager.GetImage(parentHandle) != nullptr ? CreateImage(width) : nullptr;
+                    }, parent.handle, source)
+                    : fManager.AddChildImage(CreateImage(width), parent.handle);
+            }
+            catch (...)
+            {
+                // Only a parent removed meanwhile is rejected.
+                if (fManager.GetImage(parent.handle) != nullptr)
+                    Fail("Adding a child to a live parent failed");
+                return;
+            }
+
+            if (handle == ImageHandleNull)
+                Fail("Adding a child failed");
+            else
+                fRegistry.AddLive({ handle, width, parent.handle });
+        }
+
+        void CheckRemovedChild(const Entry& entry)
+        {
+            if (entry.parent == ImageHandleNull)
+                return;
+
+            const ImageManager::VecImageHandles children = fManager.GetChildrenOf(entry.parent);
+            if (std::find(children.begin(), children.end(), entry.handle) != children.end())
+                Fail("A removed child is still listed by its parent");
+        }
+
+        void RemoveOne(std::mt19937& random)
+        {
+            Entry entry;
+            if (fRegistry.TakeLive(random, entry) == false)
+                return;
+
+            // A child is removed together with its parent, otherwise removing a live handle must succeed.
+            const bool removed = fManager.RemoveImage(entry.handle);
+            if (removed == false && entry.parent == ImageHandleNull)
+                Fail("Removing a live image failed");
+
+            fRegistry.MarkRemoved(entry.handle);
+            CheckRemovedChild(entry);
+        }
+
+        void RemoveBulk(std::mt19937& random)
+        {
+            std::vector<Entry> entries;
+            const size_t count = std::uniform_int_distribution<size_t>(1, 4)(random);
+            for (Entry entry; entries.size() < count && fRegistry.TakeLive(random, entry);)
+                entries.push_back(entry);
+
+            std::vector<ImageHandle> handles;
+            for (const Entry& entry : entries)
+                handles.push_back(entry.handle);
+
+            std::vector<IMCodec::ImageSharedPtr> removedImages;
+            const size_t numRemoved = fManager.RemoveImages(handles.data(), handles.size(), removedImages);
+            if (numRemoved > handles.size())
+                Fail("RemoveImages removed more handles than requested");
+
+            for (const Entry& entry : entries)
+            {
+                fRegistry.MarkRemoved(entry.handle);
+                CheckRemovedChild(entry);
+            }
+        }
+
+        void Writer(uint32_t threadIndex)
+        {
+            std::mt19937 random(fOptions.seed + threadIndex);
+            for (uint32_t i = 0; i < fOptions.iterations; i++)
+            {
+                switch (std::uniform_int_distribution<int>(0, 9)(random))
+                {
+                case 0:
+                case 1:
+                case 2:
+                    AddRoot(random);
+                    break;
+                case 3:
+                case 4:
+                    AddChild(random, false);
+                    break;
+                case 5:
+                    AddChild(random, true);
+                    break;
+                case 6:
+                case 7:
+                    RemoveOne(random);
+                    break;
+                case 8:
+                    RemoveBulk(random);
+                    break;
+                default:
+                    // Raising the budget lets evicted images stay in memory when recreated, lowering it evicts them again.
+                    if (threadIndex == 0 && i % 64 == 0)
+                        fManager.SetBudget((i / 64) % 2 == 0 ? LargeBudgetInBytes : SmallBudgetInBytes);
+                    break;
+                }
+            }
+        }
+
+        void Reader(uint32_t threadIndex)
+        {
+            std::mt19937 random(fOptions.seed + threadIndex);
+            const uint64_t iterations = uint64_t{ fOptions.iterations } * 4;
+            for (uint64_t i = 0; i < iterations; i++)
+            {
+                const int operation = std::uniform_int_distribution<int>(0, 3)(random);
+                if (operation < 3)
+                {
+                    // Resolving may recreate an evicted image, the live handle may also be removed meanwhile.
+                    Entry entry;
+                    if (fRegistry.PickLive(random, entry))
+                    {
+                        const IMCodec::ImageSharedPtr image = fManager.GetImage(entry.handle);
+                        if (image != nullptr && (image->GetWidth() != entry.width || image->GetHeight() != ImageHeight))
+                            Fail("A handle resolved to another image");
+                    }
+                }
+                else
+                {
+                    ImageHandle handle;
+                    if (fRegistry.PickStale(random, handle))
+                    {
+                        if (fManager.GetImage(handle) != nullptr)
+                            Fail("A removed handle resolved");
+                        if (fManager.GetChildrenOf(handle).empty() == false)
+                            Fail("A removed handle has children");
+                    }
+                }
+
+                const ImageManager::Statistics statistics = fManager.GetStatistics();
+                if (statistics.numEvictedImages > statistics.numImages)
+                    Fail("More evicted images than images");
+            }
+        }
+
+        void CheckRemoveAll()
+        {
+            const ImageManager::Statistics beforeStatistics = fManager.GetStatistics();
+            if (beforeStatistics.evictions == 0 || beforeStatistics.recreations == 0)
+                Fail("Images were never evicted and recreated");
+
+            for (const Entry& entry : fRegistry.TakeAllLive())
+                fManager.RemoveImage(entry.handle);
+
+            const ImageManager::Statistics statistics = fManager.GetStatistics();
+            if (fManager.GetNumLoadedImages() != 0 || statistics.numImages != 0 || statistics.numEvictedImages != 0 || statistics.sizeInBytes != 0)
+                Fail("Images are left after removing all handles");
+
+            std::cout << "evictions: " << beforeStatistics.evictions << ", recreations: " << beforeStatistics.recreations
+                << ", peak size: " << beforeStatistics.peakSizeInBytes << " bytes\n";
+        }
+
+    private:
+        const Options fOptions;
+        ImageManager fManager;
+        Registry fRegistry;
+        std::atomic_size_t fFailures = 0;
+        std::mutex fOutputMutex;
+    };
+
+    bool ParseOptions(int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--seed" && hasValue)
+                options.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else if (arg == "--iterations" && hasValue)
+                options.iterations = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else if (arg == "--readers" && hasValue)
+                options.readers = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else if (arg == "--writers" && hasValue)
+                options.writers = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+            else
+                return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (ParseOptions(argc, argv, options) == false)
+    {
+        std::cerr << "Usage: ImageManagerStressTest [--seed n] [--iterations n] [--readers n] [--writers n]\n";
+        return 2;
+    }
+
+    StressTest test(options);
+    const size_t failures = test.Run();
+    std::cout << (failures == 0 ? "passed" : "FAILED") << '\n';
+    return failures == 0 ? 0 : 1;
+}
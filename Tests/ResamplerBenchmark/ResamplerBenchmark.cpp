@@ -0,0 +1,536 @@
+// Headless benchmark of the resampling hot path.
+// Times Resampler::Resample and OIV::Resample over a grid of source sizes, scale ratios, thread counts and texel formats
+// and writes the results as JSON or CSV. Passing a CSV of a previous run as a baseline reports the cases that got slower.
+// Small targets are also resampled by spawning threads on every call, as before the persistent pool, to measure the pool's gain.
+//
+// Usage: ResamplerBenchmark [--format json|csv] [--output file] [--iterations n] [--quick]
+//                           [--baseline file.csv] [--threshold percent]
+
+#include <Resampler.h>
+#include <System.h>
+#include <oiv.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace OIV;
+
+    struct TexelLayout
+    {
+        const char* name;
+        ResampleChannelType channelType;
+        uint8_t numChannels;
+        size_t channelSize;
+        IMCodec::TexelFormat texelFormat;
+    };
+
+    const TexelLayout TexelLayouts[] =
+    {
+          { "RGBA8", ResampleChannelType::UInt8, 4, 1, IMCodec::TexelFormat::I_R8_G8_B8_A8 }
+        , { "RGB8", ResampleChannelType::UInt8, 3, 1, IMCodec::TexelFormat::I_R8_G8_B8 }
+        , { "RGBA16", ResampleChannelType::UInt16, 4, 2, IMCodec::TexelFormat::I_R16_G16_B16_A16 }
+        , { "RGB32F", ResampleChannelType::Float32, 3, 4, IMCodec::TexelFormat::F_R32_G32_B32 }
+    };
+
+    struct FilterInfo
+    {
+        const char* name;
+        ResampleFilter filter;
+        OIV_Resample_Filter apiFilter; // RF_Count if not exposed by the API.
+    };
+
+    const FilterInfo Filters[] =
+    {
+          { "Box", ResampleFilter::Box, RF_Box }
+        , { "BoxReference", ResampleFilter::BoxReference, RF_Count }
+        , { "Lanczos3", ResampleFilter::Lanczos3, RF_Lanczos3 }
+        , { "Nearest", ResampleFilter::Nearest, RF_Nearest }
+        , { "Bilinear", ResampleFilter::Bilinear, RF_Bilinear }
+        , { "Bicubic", ResampleFilter::Bicubic, RF_Bicubic }
+    };
+
+    struct Options
+    {
+        std::string format = "json";
+        std::string outputPath;
+        std::string baselinePath;
+        uint32_t iterations = 5;
+        double thresholdPercent = 10.0;
+        bool quick = false;
+    };
+
+    struct Result
+    {
+        std::string api;
+        std::string filter;
+        std::string format;
+        uint32_t sourceWidth;
+        uint32_t sourceHeight;
+        uint32_t targetWidth;
+        uint32_t targetHeight;
+        uint32_t threads;
+        std::string cache; // Tile cache state of OIV::Resample, "none" for Resampler::Resample.
+        uint32_t iterations;
+        double minMs;
+        double medianMs;
+        double meanMs;
+        double sourceMTexelsPerSecond;
+        double loadBalance; // 1 when all resampling threads were equally busy, 0 if unknown.
+        double poolSpeedup = 0.0; // Median of spawning threads per call divided by the median of the pool, 0 if not measured.
+
+        // Identifies the same case across runs.
+        std::string GetKey() const
+        {
+            std::ostringstream key;
+            key << api << ',' << filter << ',' << format << ',' << sourceWidth << ',' << sourceHeight << ','
+                << targetWidth << ',' << targetHeight << ',' << threads << ',' << cache;
+            return key.str();
+        }
+    };
+
+    template <typename Func>
+    std::vector<double> Measure(uint32_t iterations, Func&& func)
+    {
+        func(); // Warm up caches, thread pools and filter weights.
+        std::vector<double> timings;
+        timings.reserve(iterations);
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            timings.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return timings;
+    }
+
+    struct LoadStatistics
+    {
+        uint64_t jobs;
+        uint64_t busyTimeNs;
+        uint64_t maxThreadBusyTimeNs;
+        uint64_t threads;
+    };
+
+    LoadStatistics GetLoadStatistics(const Resampler& resampler)
+    {
+        const ResamplerStatistics statistics = resampler.GetStatistics();
+        return { statistics.jobs, statistics.busyTimeNs, statistics.maxThreadBusyTimeNs, statistics.threads };
+    }
+
+    LoadStatistics GetLoadStatistics(::OIV::OIV& api)
+    {
+        OIV_CMD_GetResamplerStatistics_Response statistics{};
+        api.GetResamplerStatistics(statistics);
+        return { statistics.jobs, statistics.busyTimeNs, statistics.maxThreadBusyTimeNs, statistics.threads };
+    }
+
+    // Load balance of the resamples made between two statistics snapshots.
+    double GetLoadBalance(const LoadStatistics& before, const LoadStatistics& after)
+    {
+        const uint64_t jobs = after.jobs - before.jobs;
+        const uint64_t maxThreadBusyTimeNs = after.maxThreadBusyTimeNs - before.maxThreadBusyTimeNs;
+        const uint64_t threads = after.threads - before.threads;
+        if (jobs == 0 || maxThreadBusyTimeNs == 0 || threads == 0)
+            return 0.0;
+
+        return static_cast<double>(after.busyTimeNs - before.busyTimeNs) * jobs / (static_cast<double>(maxThreadBusyTimeNs) * threads);
+    }
+
+    template <typename Statistics, typename Func>
+    std::vector<double> Measure(uint32_t iterations, Statistics&& getStatistics, double& loadBalance, Func&& func)
+    {
+        const LoadStatistics before = getStatistics();
+        std::vector<double> timings = Measure(iterations, func);
+        loadBalance = GetLoadBalance(before, getStatistics());
+        return timings;
+    }
+
+    Result MakeResult(std::string api, const FilterInfo& filter, const TexelLayout& layout, uint32_t sourceWidth, uint32_t sourceHeight
+        , uint32_t targetWidth, uint32_t targetHeight, uint32_t threads, std::string cache, std::vector<double> timings, double loadBalance)
+    {
+        std::sort(timings.begin(), timings.end());
+        Result result{ std::move(api), filter.name, layout.name, sourceWidth, sourceHeight, targetWidth, targetHeight, threads, std::move(cache)
+            , static_cast<uint32_t>(timings.size()) };
+        result.minMs = timings.front();
+        result.medianMs = timings[timings.size() / 2];
+        result.meanMs = std::accumulate(timings.begin(), timings.end(), 0.0) / timings.size();
+        result.sourceMTexelsPerSecond = static_cast<double>(sourceWidth) * sourceHeight / (result.medianMs * 1000.0);
+        result.loadBalance = loadBalance;
+        return result;
+    }
+
+    std::vector<uint8_t> CreateSource(const TexelLayout& layout, uint32_t width, uint32_t height)
+    {
+        std::vector<uint8_t> buffer(static_cast<size_t>(width) * height * layout.numChannels * layout.channelSize);
+        if (layout.channelType == ResampleChannelType::Float32)
+        {
+            float* texels = reinterpret_cast<float*>(buffer.data());
+            for (size_t i = 0; i < buffer.size() / sizeof(float); i++)
+                texels[i] = static_cast<float>((i * 2654435761u) >> 16) / 65536.0f;
+        }
+        else
+        {
+            for (size_t i = 0; i < buffer.size(); i++)
+                buffer[i] = static_cast<uint8_t>((i * 2654435761u) >> 13);
+        }
+        return buffer;
+    }
+
+    IMCodec::ImageItemSharedPtr CreateImageItem(const TexelLayout& layout, uint32_t width, uint32_t height, const std::vector<uint8_t>& texels)
+    {
+        using namespace IMCodec;
+        ImageItemSharedPtr imageItem = std::make_shared<ImageItem>();
+        ImageDescriptor& desc = imageItem->descriptor;
+        desc.width = width;
+        desc.height = height;
+        desc.rowPitchInBytes = width * layout.numChannels * layout.channelSize;
+        desc.texelFormatDecompressed = layout.texelFormat;
+        desc.texelFormatStorage = layout.texelFormat;
+        imageItem->data.Allocate(texels.size());
+        imageItem->data.Write(reinterpret_cast<const std::byte*>(texels.data()), 0, texels.size());
+        return imageItem;
+    }
+
+    // Resamples the way it was done before the persistent pool, threads are created and joined on every call
+    // and each resamples an equal band of target rows.
+    class SpawningResampler
+    {
+    public:
+        explicit SpawningResampler(uint32_t numThreads)
+        {
+            // A resampler of a single thread resamples in the calling thread.
+            for (uint32_t i = 0; i < numThreads; i++)
+                fResamplers.push_back(std::make_unique<Resampler>(1));
+        }
+
+        void Resample(const ResamplerParams& params, size_t texelSize)
+        {
+            // An empty band would resample the whole image.
+            const size_t numThreads = std::min<size_t>(fResamplers.size(), params.targetHeight);
+            const size_t rowSize = params.targetWidth * texelSize;
+            std::vector<std::thread> threads;
+            threads.reserve(numThreads);
+            for (size_t i = 0; i < numThreads; i++)
+            {
+                const uint32_t startY = static_cast<uint32_t>(i * params.targetHeight / numThreads);
+                const uint32_t endY = static_cast<uint32_t>((i + 1) * params.targetHeight / numThreads);
+                ResamplerParams band = params;
+                band.targetRegion = { 0, startY, params.targetWidth, endY - startY };
+                band.targetBuffer = static_cast<uint8_t*>(params.targetBuffer) + startY * rowSize;
+                threads.emplace_back([resampler = fResamplers[i].get(), band] { resampler->Resample(band); });
+            }
+
+            for (std::thread& thread : threads)
+                thread.join();
+        }
+
+    private:
+        std::vector<std::unique_ptr<Resampler>> fResamplers;
+    };
+
+    std::vector<uint32_t> GetThreadCounts(bool quick)
+    {
+        const uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        std::vector<uint32_t> threadCounts = quick ? std::vector<uint32_t>{ hardwareThreads } : std::vector<uint32_t>{ 1, 2, 4, hardwareThreads / 2, hardwareThreads };
+        threadCounts.erase(std::remove_if(threadCounts.begin(), threadCounts.end(), [&](uint32_t count) { return count == 0 || count > hardwareThreads; }), threadCounts.end());
+        std::sort(threadCounts.begin(), threadCounts.end());
+        threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+        return threadCounts;
+    }
+
+    // Upscaling the largest sources would take gigabytes.
+    constexpr uint32_t MaxTargetDimension = 8192;
+    // Spawning threads costs about the same at any ratio, it's only significant for small targets.
+    constexpr double MaxSpawnComparisonRatio = 0.1;
+
+    std::vector<Result> RunBenchmarks(const Options& options)
+    {
+        struct Size { uint32_t width; uint32_t height; };
+        const std::vector<Size> sourceSizes = options.quick ? std::vector<Size>{ { 1920, 1080 } } : std::vector<Size>{ { 1920, 1080 }, { 4096, 3072 }, { 7680, 4320 } };
+        const std::vector<double> ratios = options.quick ? std::vector<double>{ 0.5, 0.1, 2.0 } : std::vector<double>{ 0.5, 0.25, 0.1, 0.03, 2.0 };
+        const std::vector<uint32_t> threadCounts = GetThreadCounts(options.quick);
+
+        std::map<uint32_t, std::unique_ptr<Resampler>> resamplers;
+        std::map<uint32_t, std::unique_ptr<SpawningResampler>> spawningResamplers;
+        for (uint32_t threads : threadCounts)
+        {
+            resamplers.emplace(threads, std::make_unique<Resampler>(threads));
+            spawningResamplers.emplace(threads, std::make_unique<SpawningResampler>(threads));
+        }
+
+        ::OIV::OIV api;
+        std::vector<Result> results;
+
+        for (const Size& size : sourceSizes)
+        {
+            for (const TexelLayout& layout : TexelLayouts)
+            {
+                const std::vector<uint8_t> source = CreateSource(layout, size.width, size.height);
+                const IMCodec::ImageItemSharedPtr sourceItem = CreateImageItem(layout, size.width, size.height, source);
+                const IMCodec::ImageSharedPtr sourceImage = std::make_shared<IMCodec::Image>(sourceItem, IMCodec::ImageItemType::Unknown);
+
+                for (double ratio : ratios)
+                {
+                    const uint32_t targetWidth = std::max(static_cast<uint32_t>(size.width * ratio), 1u);
+                    const uint32_t targetHeight = std::max(static_cast<uint32_t>(size.height * ratio), 1u);
+                    if (targetWidth > MaxTargetDimension || targetHeight > MaxTargetDimension)
+                        continue;
+
+                    std::vector<uint8_t> target(static_cast<size_t>(targetWidth) * targetHeight * layout.numChannels * layout.channelSize);
+
+                    for (const FilterInfo& filter : Filters)
+                    {
+                        const bool isRGBA8 = layout.channelType == ResampleChannelType::UInt8 && layout.numChannels == 4;
+                        if (filter.filter == ResampleFilter::BoxReference && isRGBA8 == false)
+                            continue;
+
+                        ResamplerParams params;
+                        params.targetBuffer = target.data();
+                        params.targetWidth = targetWidth;
+                        params.targetHeight = targetHeight;
+                        params.sourceBuffer = source.data();
+                        params.sourceWidth = size.width;
+                        params.sourceHeight = size.height;
+                        params.channelType = layout.channelType;
+                        params.numChannels = layout.numChannels;
+                        params.filter = filter.filter;
+
+                        for (uint32_t threads : threadCounts)
+                        {
+                            Resampler& resampler = *resamplers.at(threads);
+                            double loadBalance;
+                            std::vector<double> timings = Measure(options.iterations, [&] { return GetLoadStatistics(resampler); }, loadBalance
+                                , [&] { resampler.Resample(params); });
+                            results.push_back(MakeResult("Resampler", filter, layout, size.width, size.height, targetWidth, targetHeight, threads, "none"
+                                , std::move(timings), loadBalance));
+
+                            if (ratio <= MaxSpawnComparisonRatio)
+                            {
+                                SpawningResampler& spawningResampler = *spawningResamplers.at(threads);
+                                const size_t texelSize = layout.numChannels * layout.channelSize;
+                                timings = Measure(options.iterations, [&] { spawningResampler.Resample(params, texelSize); });
+                                Result spawnResult = MakeResult("ResamplerSpawn", filter, layout, size.width, size.height, targetWidth, targetHeight, threads, "none"
+                                    , std::move(timings), 0.0);
+                                results.back().poolSpeedup = spawnResult.medianMs / results.back().medianMs;
+                                results.push_back(std::move(spawnResult));
+                            }
+                            std::cerr << '.' << std::flush;
+                        }
+
+                        if (filter.apiFilter == RF_Count)
+                            continue;
+
+                        const LLUtils::PointI32 targetSize{ static_cast<int32_t>(targetWidth), static_cast<int32_t>(targetHeight) };
+                        const OIV_RECT_I wholeImage{};
+                        const uint32_t apiThreads = System::GetIdealNumThreadsForMemoryOperations();
+
+                        auto getApiStatistics = [&] { return GetLoadStatistics(api); };
+                        double loadBalance;
+
+                        // A new image for every call misses the tile cache.
+                        std::vector<double> timings = Measure(options.iterations, getApiStatistics, loadBalance, [&]
+                            {
+                                const IMCodec::ImageSharedPtr image = std::make_shared<IMCodec::Image>(sourceItem, IMCodec::ImageItemType::Unknown);
+                                api.Resample(image, targetSize, filter.apiFilter, wholeImage);
+                            });
+                        results.push_back(MakeResult("OIV", filter, layout, size.width, size.height, targetWidth, targetHeight, apiThreads, "cold"
+                            , std::move(timings), loadBalance));
+
+                        timings = Measure(options.iterations, getApiStatistics, loadBalance, [&] { api.Resample(sourceImage, targetSize, filter.apiFilter, wholeImage); });
+                        results.push_back(MakeResult("OIV", filter, layout, size.width, size.height, targetWidth, targetHeight, apiThreads, "warm"
+                            , std::move(timings), loadBalance));
+                        std::cerr << '.' << std::flush;
+                    }
+                }
+            }
+        }
+        std::cerr << '\n';
+        return results;
+    }
+
+    const char* GetSimdLevelName(SimdLevel level)
+    {
+        switch (level)
+        {
+        case SimdLevel::Scalar:
+            return "Scalar";
+        case SimdLevel::SSE2:
+            return "SSE2";
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::NEON:
+            return "NEON";
+        default:
+            return "Unknown";
+        }
+    }
+
+    const char* CsvHeader = "api,filter,format,sourceWidth,sourceHeight,targetWidth,targetHeight,threads,cache,iterations,minMs,medianMs,meanMs,sourceMTexelsPerSecond,loadBalance,poolSpeedup";
+
+    void WriteCsv(std::ostream& stream, const std::vector<Result>& results)
+    {
+        stream << CsvHeader << '\n';
+        for (const Result& result : results)
+        {
+            stream << result.GetKey() << ',' << result.iterations << ',' << result.minMs << ',' << result.medianMs << ','
+                << result.meanMs << ',' << result.sourceMTexelsPerSecond << ',' << result.loadBalance << ',' << result.poolSpeedup << '\n';
+        }
+    }
+
+    void WriteJson(std::ostream& stream, const std::vector<Result>& results)
+    {
+        stream << "{\n"
+            << "  \"simdLevel\": \"" << GetSimdLevelName(ResamplerKernels::GetBestSupportedLevel()) << "\",\n"
+            << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n"
+            << "  \"results\": [\n";
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& result = results[i];
+            stream << "    { \"api\": \"" << result.api << "\", \"filter\": \"" << result.filter << "\", \"format\": \"" << result.format << "\""
+                << ", \"sourceWidth\": " << result.sourceWidth << ", \"sourceHeight\": " << result.sourceHeight
+                << ", \"targetWidth\": " << result.targetWidth << ", \"targetHeight\": " << result.targetHeight
+                << ", \"threads\": " << result.threads << ", \"cache\": \"" << result.cache << "\", \"iterations\": " << result.iterations
+                << ", \"minMs\": " << result.minMs << ", \"medianMs\": " << result.medianMs << ", \"meanMs\": " << result.meanMs
+                << ", \"sourceMTexelsPerSecond\": " << result.sourceMTexelsPerSecond << ", \"loadBalance\": " << result.loadBalance
+                << ", \"poolSpeedup\": " << result.poolSpeedup << " }"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+
+        stream << "  ]\n}\n";
+    }
+
+    // Median timings of a previous CSV run by case key.
+    std::map<std::string, double> ReadBaseline(const std::string& path)
+    {
+        std::map<std::string, double> baseline;
+        std::ifstream file(path);
+        if (file.is_open() == false)
+            throw std::runtime_error("Unable to open baseline file: " + path);
+
+        std::string line;
+        std::getline(file, line); // Header
+        constexpr size_t NumKeyFields = 9;
+        constexpr size_t MedianField = 11;
+        while (std::getline(file, line))
+        {
+            std::vector<std::string> fields;
+            std::istringstream lineStream(line);
+            std::string field;
+            while (std::getline(lineStream, field, ','))
+                fields.push_back(field);
+
+            if (fields.size() <= MedianField)
+                continue;
+
+            std::string key = fields[0];
+            for (size_t i = 1; i < NumKeyFields; i++)
+                key += ',' + fields[i];
+            baseline[key] = std::stod(fields[MedianField]);
+        }
+        return baseline;
+    }
+
+    // Returns the number of cases slower than the baseline by more than the threshold.
+    size_t CompareToBaseline(const std::vector<Result>& results, const std::map<std::string, double>& baseline, double thresholdPercent)
+    {
+        size_t numRegressions = 0;
+        for (const Result& result : results)
+        {
+            auto it = baseline.find(result.GetKey());
+            if (it == baseline.end() || it->second <= 0.0)
+                continue;
+
+            const double changePercent = (result.medianMs / it->second - 1.0) * 100.0;
+            if (changePercent > thresholdPercent)
+            {
+                std::cerr << "Regression: " << result.GetKey() << " median " << it->second << "ms -> " << result.medianMs << "ms (+" << changePercent << "%)\n";
+                numRegressions++;
+            }
+        }
+        return numRegressions;
+    }
+
+    bool ParseOptions(int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--format" && hasValue)
+                options.format = argv[++i];
+            else if (arg == "--output" && hasValue)
+                options.outputPath = argv[++i];
+            else if (arg == "--baseline" && hasValue)
+                options.baselinePath = argv[++i];
+            else if (arg == "--iterations" && hasValue)
+                options.iterations = static_cast<uint32_t>(std::max(std::stoi(argv[++i]), 1));
+            else if (arg == "--threshold" && hasValue)
+                options.thresholdPercent = std::stod(argv[++i]);
+            else if (arg == "--quick")
+                options.quick = true;
+            else
+                return false;
+        }
+        return options.format == "json" || options.format == "csv";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (ParseOptions(argc, argv, options) == false)
+    {
+        std::cerr << "Usage: ResamplerBenchmark [--format json|csv] [--output file] [--iterations n] [--quick] [--baseline file.csv] [--threshold percent]\n";
+        return 2;
+    }
+
+    try
+    {
+        const std::vector<Result> results = RunBenchmarks(options);
+
+        std::ofstream outputFile;
+        if (options.outputPath.empty() == false)
+        {
+            outputFile.open(options.outputPath);
+            if (outputFile.is_open() == false)
+            {
+                std::cerr << "Unable to open output file: " << options.outputPath << '\n';
+                return 2;
+            }
+        }
+
+        std::ostream& output = outputFile.is_open() ? outputFile : std::cout;
+        if (options.format == "csv")
+            WriteCsv(output, results);
+        else
+            WriteJson(output, results);
+
+        if (options.baselinePath.empty() == false)
+        {
+            const size_t numRegressions = CompareToBaseline(results, ReadBaseline(options.baselinePath), options.thresholdPercent);
+            std::cerr << numRegressions << " regression(s) above " << options.thresholdPercent << "%\n";
+            return numRegressions == 0 ? 0 : 1;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Compares the SIMD resampler kernels of every instruction set supported by the running CPU to the scalar kernels.
+// Rows, spans and widths are random, including odd widths and spans shorter than a vector, output must be bit exact.
+//
+// Usage: ResamplerKernelsTest [--seed n] [--iterations n]
+
+#include <ResamplerKernels.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace OIV;
+
+    constexpr size_t NumChannels = 4;
+
+    struct Options
+    {
+        uint32_t seed = 1;
+        uint32_t iterations = 2000;
+    };
+
+    const char* GetLevelName(SimdLevel level)
+    {
+        switch (level)
+        {
+        case SimdLevel::Scalar:
+            return "Scalar";
+        case SimdLevel::SSE2:
+            return "SSE2";
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::NEON:
+            return "NEON";
+        default:
+            return "Unknown";
+        }
+    }
+
+    std::vector<uint8_t> RandomBytes(std::mt19937& random, size_t size)
+    {
+        std::uniform_int_distribution<int> byteDistribution(0, 255);
+        std::vector<uint8_t> bytes(size);
+        for (uint8_t& byte : bytes)
+            byte = static_cast<uint8_t>(byteDistribution(random));
+        return bytes;
+    }
+
+    // Returns the number of mismatching spans.
+    size_t TestSumRowSpans(const ResamplerKernels& kernels, std::mt19937& random, const Options& options)
+    {
+        const ResamplerKernels& reference = ResamplerKernels::Get(SimdLevel::Scalar);
+        size_t mismatches = 0;
+        for (uint32_t iteration = 0; iteration < options.iterations; iteration++)
+        {
+            // Rows are allocated to their exact size so reads past the last texel are caught by the address sanitizer.
+            const size_t width = std::uniform_int_distribution<size_t>(1, 257)(random);
+            const std::vector<uint8_t> row = RandomBytes(random, width * NumChannels);
+
+            // Mix empty, single texel, vector sized and full row spans, and spans ending at the last texel.
+            const size_t numSpans = std::uniform_int_distribution<size_t>(1, 16)(random);
+            std::vector<SourceSpan> spans(numSpans);
+            for (SourceSpan& span : spans)
+            {
+                span.start = std::uniform_int_distribution<size_t>(0, width - 1)(random);
+                const size_t maxLength = width - span.start;
+                switch (std::uniform_int_distribution<int>(0, 3)(random))
+                {
+                case 0:
+                    span.end = span.start + std::min<size_t>(std::uniform_int_distribution<size_t>(0, 9)(random), maxLength);
+                    break;
+                case 1:
+                    span.end = width;
+                    break;
+                case 2:
+                    span.start = 0;
+                    span.end = width;
+                    break;
+                default:
+                    span.end = span.start + std::uniform_int_distribution<size_t>(0, maxLength)(random);
+                    break;
+                }
+            }
+
+            std::vector<uint32_t> expected(numSpans * NumChannels, 0xDEADBEEF);
+            std::vector<uint32_t> actual(numSpans * NumChannels, 0xDEADBEEF);
+            reference.sumRowSpans(row.data(), spans.data(), numSpans, expected.data());
+            kernels.sumRowSpans(row.data(), spans.data(), numSpans, actual.data());
+
+            for (size_t i = 0; i < numSpans; i++)
+            {
+                if (std::memcmp(expected.data() + i * NumChannels, actual.data() + i * NumChannels, NumChannels * sizeof(uint32_t)) != 0)
+                {
+                    if (mismatches++ == 0)
+                        std::cerr << GetLevelName(kernels.level) << " sumRowSpans mismatch: width " << width
+                            << " span [" << spans[i].start << ", " << spans[i].end << ")\n";
+                }
+            }
+        }
+        return mismatches;
+    }
+
+    // Returns the number of mismatching rows.
+    size_t TestAverage2x2(const ResamplerKernels& kernels, std::mt19937& random, const Options& options)
+    {
+        const ResamplerKernels& reference = ResamplerKernels::Get(SimdLevel::Scalar);
+        size_t mismatches = 0;
+        for (uint32_t iteration = 0; iteration < options.iterations; iteration++)
+        {
+            const size_t targetWidth = std::uniform_int_distribution<size_t>(1, 131)(random);
+            const std::vector<uint8_t> row0 = RandomBytes(random, targetWidth * 2 * NumChannels);
+            const std::vector<uint8_t> row1 = RandomBytes(random, targetWidth * 2 * NumChannels);
+
+            std::vector<uint8_t> expected(targetWidth * NumChannels);
+            std::vector<uint8_t> actual(targetWidth * NumChannels);
+            reference.average2x2(row0.data(), row1.data(), targetWidth, expected.data());
+            kernels.average2x2(row0.data(), row1.data(), targetWidth, actual.data());
+
+            if (expected != actual)
+            {
+                if (mismatches++ == 0)
+                    std::cerr << GetLevelName(kernels.level) << " average2x2 mismatch: target width " << targetWidth << '\n';
+            }
+        }
+        return mismatches;
+    }
+
+    bool ParseOptions(int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--seed" && hasValue)
+                options.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else if (arg == "--iterations" && hasValue)
+                options.iterations = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else
+                return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (ParseOptions(argc, argv, options) == false)
+    {
+        std::cerr << "Usage: ResamplerKernelsTest [--seed n] [--iterations n]\n";
+        return 2;
+    }
+
+    size_t failures = 0;
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON })
+    {
+        if (ResamplerKernels::IsSupported(level) == false)
+        {
+            std::cout << GetLevelName(level) << ": not supported, skipped\n";
+            continue;
+        }
+
+        const ResamplerKernels& kernels = ResamplerKernels::Get(level);
+        std::mt19937 random(options.seed);
+        const size_t mismatches = TestSumRowSpans(kernels, random, options) + TestAverage2x2(kernels, random, options);
+        std::cout << GetLevelName(level) << ": " << (mismatches == 0 ? "passed" : "FAILED") << '\n';
+        failures += mismatches;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -48,6 +48,12 @@ namespace OIV
 
         void SetUnderlyingImage(IMCodec::ImageSharedPtr image);
 
+        // A derived image may prepare its sub-images on first access, use this instead of the sub-images of GetImage().
+        virtual IMCodec::ImageSharedPtr GetSubImage(uint16_t index)
+        {
+            return fImage->GetSubImage(index);
+        }
+
         void SetMetaData(IMCodec::ItemMetaDataSharedPtr metaData)
         {
             fImageMetaData = metaData;
@@ -2,6 +2,8 @@
 #include "OIVBaseImage.h"
 #include <defs.h>
 #include <ImageLoader.h>
+#include <mutex>
+#include <vector>
 
 namespace OIV
 {
@@ -13,7 +15,12 @@ namespace OIV
         OIVFileImage(const LLUtils::native_string_type& fileName);
         ResultCode Load(IMCodec::ImageLoader* imageCodec, IMCodec::PluginTraverseMode loaderFlags, IMCodec::ImageLoadFlags imageLoadFlags, const IMCodec::Parameters& params);
         ResultCode Load(IMCodec::ImageLoader* imageCodec, IMCodec::PluginTraverseMode loaderFlags);
+        // Sub-images are EXIF oriented on first access.
+        IMCodec::ImageSharedPtr GetSubImage(uint16_t index) override;
     private:
         const LLUtils::native_string_type fFileName;
+        unsigned short fExifOrientation = 0;
+        std::vector<IMCodec::ImageSharedPtr> fOrientedSubImages;
+        std::mutex fSubImagesMutex;
     };
 }
\ No newline at end of file
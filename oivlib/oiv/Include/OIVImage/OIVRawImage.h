@@ -21,5 +21,7 @@ namespace OIV
     public:
         OIVRawImage(ImageSource customImagesource) : OIVBaseImage(customImagesource) { }
         ResultCode Load(const RawBufferParams& loadParams, const IMUtil::AxisAlignedTransform& transform);
+        // Copies the buffer once, the caller's buffer may be released when it returns.
+        static IMCodec::ImageSharedPtr CreateImage(const RawBufferParams& loadParams, const IMUtil::AxisAlignedTransform& transform);
     };
 }
\ No newline at end of file
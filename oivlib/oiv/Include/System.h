@@ -6,6 +6,10 @@ namespace OIV
 	class System
 	{
 	public:
+		// Thread count with the highest throughput for memory bound operations such as resampling.
+		// Measured once per machine and cached in the app data folder, the cache is discarded when the number of logical cores changes.
 		static uint32_t GetIdealNumThreadsForMemoryOperations();
+		// Measure the throughput of a memory bound kernel at several thread counts, takes a fraction of a second.
+		static uint32_t CalibrateNumThreadsForMemoryOperations();
 	};
-}
\ No newline at end of file
+}
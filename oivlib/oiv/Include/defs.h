@@ -20,8 +20,12 @@ typedef wchar_t OIVCHAR;
 
 
 
-    typedef int16_t ImageHandle;
+    // The lower bits index the image slot, the upper bits hold the generation of the slot, so a handle of a removed image is never valid again.
+    typedef uint32_t ImageHandle;
     const ImageHandle ImageHandleNull = 0;
+    // Identifies an asynchronous command.
+    typedef uint64_t OIV_Ticket;
+    const OIV_Ticket OIV_TicketNull = 0;
 
 
     enum CommandExecute
@@ -50,6 +54,15 @@ typedef wchar_t OIVCHAR;
         , OIV_CMD_RegisterCallbacks
         , OIV_CMD_GetSubImages
         , OIV_CMD_ResampleImage
+        , OIV_CMD_GetResamplerStatistics
+        , OIV_CMD_SetImageMemoryBudget
+        , OIV_CMD_GetImageMemoryStatistics
+        , OIV_CMD_ExecuteBatch
+        , OIV_CMD_ExecuteAsync
+        , OIV_CMD_GetAsyncStatus
+        , OIV_CMD_GetStatistics
+        , OIV_CMD_ResetStatistics
+        , OIV_CMD_UnloadFiles
     };
 
     
@@ -166,10 +179,24 @@ typedef wchar_t OIVCHAR;
         uint32_t y;
     };
 
+    enum OIV_Resample_Filter
+    {
+          RF_Box
+        , RF_Lanczos3
+        , RF_Mitchell
+        , RF_CatmullRom
+        , RF_Nearest
+        , RF_Bilinear
+        , RF_Bicubic
+        , RF_Count
+    };
+
     struct OIV_CMD_Resample_Request
     {
         ImageHandle imageHandle;
         LLUtils::PointI32 size;
+        OIV_Resample_Filter filter;
+        OIV_RECT_I region; // Part of the resampled image to create, an empty rect creates the whole image.
     };
 
     struct OIV_CMD_Resample_Response
@@ -177,6 +204,142 @@ typedef wchar_t OIVCHAR;
         ImageHandle imageHandle;
     };
 
+    struct OIV_CMD_GetResamplerStatistics_Response
+    {
+        uint64_t tileCacheHits;
+        uint64_t tileCacheMisses;
+        uint64_t tileCacheEvictions;
+        uint64_t tileCacheNumTiles;
+        uint64_t tileCacheSizeInBytes;
+        uint64_t tileCacheBudgetInBytes;
+        uint64_t cancelledJobs;
+        uint64_t cancelledRows; // Target rows not resampled thanks to cancellation.
+        uint64_t jobs;
+        uint64_t chunks; // Row chunks handed out to the resampling threads.
+        // Load balance of the resampling threads is busyTimeNs * jobs / (maxThreadBusyTimeNs * threads).
+        uint64_t busyTimeNs;
+        uint64_t maxThreadBusyTimeNs;
+        uint64_t threads;
+    };
+
+    // Images created from other images by the library (converted, cropped, transformed and resampled) are evicted
+    // least recently used first when the images held exceed the budget, and recreated when their handle is used again.
+    struct OIV_CMD_SetImageMemoryBudget_Request
+    {
+        uint64_t budgetInBytes;
+    };
+
+    struct OIV_CMD_GetImageMemoryStatistics_Response
+    {
+        uint64_t numImages;
+        uint64_t numEvictedImages;
+        uint64_t sizeInBytes;
+        uint64_t peakSizeInBytes;
+        uint64_t budgetInBytes;
+        uint64_t evictions;
+        uint64_t recreations;
+    };
+
+    // A batch records many commands in one buffer and executes them in a single call.
+    // Each command is an OIV_Batch_Command header followed by its request and then room for its response,
+    // the request and the response are each padded to OIV_Batch_Alignment bytes. Responses are written into the buffer.
+    constexpr uint32_t OIV_Batch_Alignment = 8;
+
+    enum OIV_Batch_Command_Flags
+    {
+          OIV_BCF_None = 0 << 0
+        // Wait for the commands before this one to complete, for a command that uses their results.
+        , OIV_BCF_Barrier = 1 << 0
+    };
+
+    struct OIV_Batch_Command
+    {
+        CommandExecute command;
+        OIV_Batch_Command_Flags flags;
+        uint32_t requestSize;
+        uint32_t responseSize;
+    };
+
+    // Image processing commands (transform, convert, crop, resample, texel info, pixels and image info) between barriers
+    // are executed in parallel, any other command executes on the calling thread after the commands before it complete.
+    struct OIV_CMD_ExecuteBatch_Request
+    {
+        void* commands;
+        uint64_t commandsSize;
+        uint32_t numCommands;
+        ResultCode* results; // Array of numCommands result codes, filled with the result of each command.
+    };
+
+    struct OIV_CMD_ExecuteBatch_Response
+    {
+        uint32_t numFailedCommands;
+    };
+
+    // Executes a command on a worker thread and returns a ticket right away, only the commands a batch executes
+    // in parallel may execute asynchronously. The request is copied, the response must stay valid until the command completes.
+    struct OIV_CMD_ExecuteAsync_Request
+    {
+        CommandExecute command;
+        const void* request;
+        uint32_t requestSize;
+        void* response;
+        uint32_t responseSize;
+    };
+
+    struct OIV_CMD_ExecuteAsync_Response
+    {
+        OIV_Ticket ticket;
+    };
+
+    enum OIV_Async_Status
+    {
+          AS_Unknown // The ticket is invalid or its completion was already reported.
+        , AS_Pending
+        , AS_Running
+        , AS_Completed
+    };
+
+    // A completion is reported once, either by a completed status or by the OnCommandCompleted callback, then the ticket is released.
+    struct OIV_CMD_GetAsyncStatus_Request
+    {
+        OIV_Ticket ticket;
+        uint32_t timeoutMs; // Time to wait for the command to complete, 0 returns the status right away.
+    };
+
+    struct OIV_CMD_GetAsyncStatus_Response
+    {
+        OIV_Async_Status status;
+        ResultCode result; // Valid when the status is AS_Completed.
+    };
+
+    // Execution statistics of a command, recorded for every command executed since the library was loaded or the statistics were reset.
+    // Percentiles are estimated from a histogram and are accurate to within 12.5%.
+    struct OIV_Command_Statistics
+    {
+        CommandExecute command;
+        uint64_t count;
+        uint64_t errors; // Executions that did not return RC_Success, including exceptions.
+        uint64_t exceptions; // Executions that threw, returned as RC_InternalError.
+        uint64_t totalTimeNs;
+        uint64_t maxTimeNs;
+        uint64_t p50TimeNs;
+        uint64_t p90TimeNs;
+        uint64_t p99TimeNs;
+    };
+
+    // Statistics of the commands executed at least once, ordered by command.
+    struct OIV_CMD_GetStatistics_Request
+    {
+        OIV_Command_Statistics* commandsArray;
+        uint32_t arraySize;
+    };
+
+    struct OIV_CMD_GetStatistics_Response
+    {
+        uint32_t numCommands; // Commands with statistics, may be larger than arraySize.
+        uint32_t copiedElements;
+    };
+
 
     struct OIV_Exception_Args
     {
@@ -187,9 +350,18 @@ typedef wchar_t OIVCHAR;
         const LLUtils::native_char_type* functionName;
     };
 
+    struct OIV_Command_Completed_Args
+    {
+        OIV_Ticket ticket;
+        CommandExecute command;
+        ResultCode result;
+    };
+
     struct OIV_CMD_RegisterCallbacks_Request
     {
         void(*OnException) (OIV_Exception_Args, void*);
+        // Called on a worker thread when an asynchronous command completes.
+        void(*OnCommandCompleted) (OIV_Command_Completed_Args, void*);
 		void* userPointer;
     };
 
@@ -227,6 +399,8 @@ typedef wchar_t OIVCHAR;
         ImageHandle handle;
     };
 
+    // The pixels are not copied, pixelBuffer is a read-only view of the image memory.
+    // It stays valid until the image is unloaded, or evicted when the image can be recreated, see OIV_CMD_SetImageMemoryBudget.
     struct OIV_CMD_GetPixels_Response
     {
         const std::byte* pixelBuffer;
@@ -293,6 +467,7 @@ typedef wchar_t OIVCHAR;
     };
 
 
+    // The buffer is copied once, flipping vertically while copying, and may be released when the command returns.
     struct OIV_CMD_LoadRaw_Request
     {
         uint32_t width;
@@ -454,11 +629,24 @@ typedef wchar_t OIVCHAR;
 
 
 
+    // Unloading an image unloads its children, and removes the renderables showing any of them from the renderer.
+    // The memory is released right away, unless the client still references the images.
     struct OIV_CMD_UnloadFile_Request
     {
         ImageHandle handle;
     };
 
+    struct OIV_CMD_UnloadFiles_Request
+    {
+        const ImageHandle* handles;
+        uint32_t numHandles;
+    };
+
+    struct OIV_CMD_UnloadFiles_Response
+    {
+        uint32_t numUnloaded; // Handles that were valid, the others are ignored.
+    };
+
 
     struct OIV_CMD_GetSubImages_Request
     {
@@ -33,6 +33,8 @@ namespace OIV
         }
     public:
         virtual ~CommandHandler() {}
+        // Whether the command may execute concurrently with other concurrent commands of a batch.
+        virtual bool IsConcurrent() const { return false; }
     protected:
         virtual ResultCode Verify([[maybe_unused]] std::size_t requestSize, [[maybe_unused]] std::size_t responseSize) { return RC_Success; }
 
@@ -10,6 +10,7 @@ LLUTILS_DISABLE_WARNING_UNUSED_PARAMETER
 #include "Handlers/CommandHandlerDestroy.h"
 #include "Handlers/CommandHandlerAxisAlignedTransform.h"
 #include "Handlers/CommandHandlerUnloadFile.h"
+#include "Handlers/CommandHandlerUnloadFiles.h"
 #include "Handlers/CommandHandlerLoadRaw.h"
 #include "Handlers/CommandHandlerSetSelectionRect.h"
 #include "Handlers/CommandHandlerCropImage.h"
@@ -24,7 +25,18 @@ LLUTILS_DISABLE_WARNING_UNUSED_PARAMETER
 #include "Handlers/CommandHandlerRegisterCallbacks.h"
 #include "Handlers/CommandHandlerGetSubImages.h"
 #include "Handlers/CommandHandlerResampleImage.h"
+#include "Handlers/CommandHandlerGetResamplerStatistics.h"
+#include "Handlers/CommandHandlerSetImageMemoryBudget.h"
+#include "Handlers/CommandHandlerGetImageMemoryStatistics.h"
+#include "Handlers/CommandHandlerExecuteBatch.h"
+#include "Handlers/CommandHandlerExecuteAsync.h"
+#include "Handlers/CommandHandlerGetAsyncStatus.h"
+#include "Handlers/CommandHandlerGetStatistics.h"
+#include "Handlers/CommandHandlerResetStatistics.h"
 LLUTILS_DISABLE_WARNING_POP
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
 namespace OIV
 {
@@ -34,6 +46,7 @@ namespace OIV
         fCommandHandlers.emplace(OIV_CMD_LoadFile, std::make_unique<CommandHandlerLoadFile>());
         fCommandHandlers.emplace(OIV_CMD_LoadRaw, std::make_unique<CommandHandlerLoadRaw>());
         fCommandHandlers.emplace(OIV_CMD_UnloadFile, std::make_unique<CommandHandlerUnloadFile>());
+        fCommandHandlers.emplace(OIV_CMD_UnloadFiles, std::make_unique<CommandHandlerUnloadFiles>());
         fCommandHandlers.emplace(CE_Refresh, std::make_unique<CommandHandlerRefresh>());
         fCommandHandlers.emplace(CE_TexelGrid, std::make_unique<CommandHandlerTexelGrid>());
         fCommandHandlers.emplace(CMD_SetClientSize, std::make_unique<CommandHandlerSetClientSize>());
@@ -52,26 +65,264 @@ namespace OIV
         fCommandHandlers.emplace(OIV_CMD_RegisterCallbacks, std::make_unique<CommandHandlerRegisterCallbacks>());
         fCommandHandlers.emplace(OIV_CMD_GetSubImages, std::make_unique<CommandHandlerGetSubImages>());
         fCommandHandlers.emplace(OIV_CMD_ResampleImage, std::make_unique<CommandHandlerResampleImage>());
+        fCommandHandlers.emplace(OIV_CMD_GetResamplerStatistics, std::make_unique<CommandHandlerGetResamplerStatistics>());
+        fCommandHandlers.emplace(OIV_CMD_SetImageMemoryBudget, std::make_unique<CommandHandlerSetImageMemoryBudget>());
+        fCommandHandlers.emplace(OIV_CMD_GetImageMemoryStatistics, std::make_unique<CommandHandlerGetImageMemoryStatistics>());
+        fCommandHandlers.emplace(OIV_CMD_ExecuteBatch, std::make_unique<CommandHandlerExecuteBatch>());
+        fCommandHandlers.emplace(OIV_CMD_ExecuteAsync, std::make_unique<CommandHandlerExecuteAsync>());
+        fCommandHandlers.emplace(OIV_CMD_GetAsyncStatus, std::make_unique<CommandHandlerGetAsyncStatus>());
+        fCommandHandlers.emplace(OIV_CMD_GetStatistics, std::make_unique<CommandHandlerGetStatistics>());
+        fCommandHandlers.emplace(OIV_CMD_ResetStatistics, std::make_unique<CommandHandlerResetStatistics>());
+    }
+
+    ResultCode CommandProcessor::ExecuteHandler(CommandExecute command, CommandHandler* handler, const std::size_t requestSize, const void* requestData, const std::size_t responseSize, void* responseData)
+    {
+        using clock = std::chrono::steady_clock;
+        const clock::time_point start = clock::now();
+        ResultCode result;
+        bool exception = false;
+        try
+        {
+            result = handler->Execute(requestData, requestSize, responseData, responseSize);
+        }
+
+        catch (...)
+        {
+            result = RC_InternalError;
+            exception = true;
+        }
+
+        fStatistics.Record(command, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count()), result, exception);
+        return result;
     }
 
     ResultCode CommandProcessor::ProcessCommand(CommandExecute command, const std::size_t requestSize, const void* requestData, const std::size_t responseSize, void* responseData)
     {
         auto pair = fCommandHandlers.find(command);
         if (pair != fCommandHandlers.end())
+            return ExecuteHandler(command, pair->second.get(), requestSize, requestData, responseSize, responseData);
+        else
+            return RC_UnknownCommand;
+    }
+
+    ThreadPool& CommandProcessor::GetThreadPool()
+    {
+        // Lazy initialize, most clients never execute a batch or an asynchronous command.
+        std::call_once(fThreadPoolOnce, [this]
+            {
+                // The calling thread takes part in executing a batch, so one worker less is needed,
+                // but asynchronous commands need at least one worker.
+                fThreadPool = std::make_unique<ThreadPool>(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+            });
+        return *fThreadPool;
+    }
+
+    ResultCode CommandProcessor::ExecuteBatch(const OIV_CMD_ExecuteBatch_Request& request, OIV_CMD_ExecuteBatch_Response& response)
+    {
+        struct BatchCommand
+        {
+            const OIV_Batch_Command* header;
+            CommandHandler* handler;
+            void* request;
+            void* response;
+        };
+
+        if (request.numCommands > 0 && (request.commands == nullptr || request.results == nullptr))
+            return RC_InvalidParameters;
+
+        if (reinterpret_cast<uintptr_t>(request.commands) % OIV_Batch_Alignment != 0)
+            return RC_InvalidParameters;
+
+        auto alignSize = [](size_t size) { return (size + OIV_Batch_Alignment - 1) / OIV_Batch_Alignment * OIV_Batch_Alignment; };
+
+        // Parse the whole buffer before executing, a malformed batch executes nothing.
+        std::vector<BatchCommand> commands;
+        commands.reserve(request.numCommands);
+        std::byte* position = static_cast<std::byte*>(request.commands);
+        const std::byte* end = position + request.commandsSize;
+        for (uint32_t i = 0; i < request.numCommands; i++)
+        {
+            if (static_cast<size_t>(end - position) < sizeof(OIV_Batch_Command))
+                return RC_BadRequestSize;
+
+            const OIV_Batch_Command* header = reinterpret_cast<const OIV_Batch_Command*>(position);
+            const size_t requestOffset = alignSize(sizeof(OIV_Batch_Command));
+            const size_t responseOffset = requestOffset + alignSize(header->requestSize);
+            const size_t commandSize = responseOffset + alignSize(header->responseSize);
+            if (static_cast<size_t>(end - position) < commandSize)
+                return RC_BadRequestSize;
+
+            std::byte* requestData = position + requestOffset;
+            std::byte* responseData = position + responseOffset;
+            position += commandSize;
+
+            auto pair = fCommandHandlers.find(header->command);
+            commands.push_back({ header, pair != fCommandHandlers.end() ? pair->second.get() : nullptr, requestData, responseData });
+        }
+
+        auto execute = [this, &request, &commands](size_t index)
+        {
+            const BatchCommand& command = commands[index];
+            request.results[index] = command.handler != nullptr
+                ? ExecuteHandler(command.header->command, command.handler, command.header->requestSize, command.request, command.header->responseSize, command.response)
+                : RC_UnknownCommand;
+        };
+
+        auto isConcurrent = [&commands](size_t index) { return commands[index].handler != nullptr && commands[index].handler->IsConcurrent(); };
+
+        // Concurrent commands up to the next barrier or non concurrent command form a group that executes in parallel.
+        size_t groupStart = 0;
+        while (groupStart < commands.size())
         {
-            try
+            size_t groupEnd = groupStart + 1;
+            if (isConcurrent(groupStart))
             {
-                return pair->second->Execute(requestData, requestSize, responseData, responseSize);
+                while (groupEnd < commands.size() && isConcurrent(groupEnd) && (commands[groupEnd].header->flags & OIV_BCF_Barrier) == 0)
+                    groupEnd++;
             }
 
-            catch (...)
+            if (groupEnd - groupStart == 1)
+                execute(groupStart);
+            else
+                GetThreadPool().ParallelFor(groupEnd - groupStart, [&execute, groupStart](size_t taskIndex) { execute(groupStart + taskIndex); });
+
+            groupStart = groupEnd;
+        }
+
+        response.numFailedCommands = static_cast<uint32_t>(std::count_if(request.results, request.results + request.numCommands
+            , [](ResultCode result) { return result != RC_Success; }));
+        return RC_Success;
+    }
+
+    ResultCode CommandProcessor::ExecuteAsync(const OIV_CMD_ExecuteAsync_Request& request, OIV_CMD_ExecuteAsync_Response& response)
+    {
+        auto pair = fCommandHandlers.find(request.command);
+        if (pair == fCommandHandlers.end())
+            return RC_UnknownCommand;
+
+        // Other commands use the renderer or state of the calling thread.
+        CommandHandler* handler = pair->second.get();
+        if (handler->IsConcurrent() == false || (request.requestSize > 0 && request.request == nullptr))
+            return RC_InvalidParameters;
+
+        const std::byte* requestBegin = static_cast<const std::byte*>(request.request);
+        std::vector<std::byte> requestData(requestBegin, requestBegin + request.requestSize);
+
+        OIV_Ticket ticket;
+        {
+            std::lock_guard<std::mutex> lock(fAsyncMutex);
+            ticket = fNextTicket++;
+            fAsyncCommands.emplace(ticket, AsyncCommand{ request.command, AS_Pending, RC_Success });
+            fNumRunningAsyncCommands++;
+        }
+
+        GetThreadPool().Enqueue([this, ticket, command = request.command, handler, requestData = std::move(requestData), responseData = request.response, responseSize = request.responseSize]()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(fAsyncMutex);
+                    fAsyncCommands.at(ticket).status = AS_Running;
+                }
+                CompleteAsyncCommand(ticket, ExecuteHandler(command, handler, requestData.size(), requestData.data(), responseSize, responseData));
+            });
+
+        response.ticket = ticket;
+        return RC_Success;
+    }
+
+    void CommandProcessor::CompleteAsyncCommand(OIV_Ticket ticket, ResultCode result)
+    {
+        OIV_Command_Completed_Args args{ ticket, CE_NoOperation, result };
+        OIV_CMD_RegisterCallbacks_Request callbacks;
+        {
+            std::lock_guard<std::mutex> lock(fAsyncMutex);
+            auto it = fAsyncCommands.find(ticket);
+            args.command = it->second.command;
+            callbacks = fCallbacks;
+            // The callback reports the completion, a completed status would never be queried.
+            if (callbacks.OnCommandCompleted != nullptr)
+            {
+                fAsyncCommands.erase(it);
+            }
+            else
             {
-                return RC_InternalError;
+                it->second.status = AS_Completed;
+                it->second.result = result;
             }
         }
-        else
+        fAsyncChanged.notify_all();
+
+        if (callbacks.OnCommandCompleted != nullptr)
+            callbacks.OnCommandCompleted(args, callbacks.userPointer);
+
         {
-            return RC_UnknownCommand;
+            std::lock_guard<std::mutex> lock(fAsyncMutex);
+            fNumRunningAsyncCommands--;
+        }
+        fAsyncChanged.notify_all();
+    }
+
+    ResultCode CommandProcessor::GetAsyncStatus(const OIV_CMD_GetAsyncStatus_Request& request, OIV_CMD_GetAsyncStatus_Response& response)
+    {
+        std::unique_lock<std::mutex> lock(fAsyncMutex);
+        auto isDone = [this, &request]
+        {
+            auto it = fAsyncCommands.find(request.ticket);
+            return it == fAsyncCommands.end() || it->second.status == AS_Completed;
+        };
+
+        fAsyncChanged.wait_for(lock, std::chrono::milliseconds(request.timeoutMs), isDone);
+
+        auto it = fAsyncCommands.find(request.ticket);
+        if (it == fAsyncCommands.end())
+        {
+            response.status = AS_Unknown;
+            response.result = RC_Success;
+            return RC_Success;
         }
+
+        response.status = it->second.status;
+        response.result = it->second.result;
+        if (it->second.status == AS_Completed)
+            fAsyncCommands.erase(it);
+
+        return RC_Success;
+    }
+
+    void CommandProcessor::RegisterCallbacks(const OIV_CMD_RegisterCallbacks_Request& callbacks)
+    {
+        std::lock_guard<std::mutex> lock(fAsyncMutex);
+        fCallbacks = callbacks;
+    }
+
+    void CommandProcessor::WaitAsyncCommands()
+    {
+        std::unique_lock<std::mutex> lock(fAsyncMutex);
+        fAsyncChanged.wait(lock, [this] { return fNumRunningAsyncCommands == 0; });
+    }
+
+    ResultCode CommandProcessor::GetStatistics(const OIV_CMD_GetStatistics_Request& request, OIV_CMD_GetStatistics_Response& response) const
+    {
+        if (request.arraySize > 0 && request.commandsArray == nullptr)
+            return RC_InvalidParameters;
+
+        response.numCommands = 0;
+        response.copiedElements = 0;
+        for (uint32_t command = 0; command < CommandStatistics::MaxCommands; command++)
+        {
+            OIV_Command_Statistics statistics;
+            if (fStatistics.Get(static_cast<CommandExecute>(command), statistics) == false)
+                continue;
+
+            if (response.copiedElements < request.arraySize)
+                request.commandsArray[response.copiedElements++] = statistics;
+            response.numCommands++;
+        }
+
+        return RC_Success;
+    }
+
+    void CommandProcessor::ResetStatistics()
+    {
+        fStatistics.Reset();
     }
 }
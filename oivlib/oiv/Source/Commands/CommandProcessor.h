@@ -1,9 +1,14 @@
 #pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
 #include <defs.h>
 #include "../IPictureRenderer.h"
 #include "CommandHandler.h"
+#include "CommandStatistics.h"
+#include "../ThreadPool.h"
 
 namespace OIV
 {
@@ -12,14 +17,47 @@ namespace OIV
     {
     private: // types
         typedef std::unordered_map<CommandExecute, std::unique_ptr<CommandHandler>> MapCommanderHandler;
+
+        struct AsyncCommand
+        {
+            CommandExecute command;
+            OIV_Async_Status status;
+            ResultCode result;
+        };
+        typedef std::unordered_map<OIV_Ticket, AsyncCommand> MapTicketAsyncCommand;
+
     public: // methods
         CommandProcessor();
         ResultCode ProcessCommand(CommandExecute command, const std::size_t requestSize, const void* requestData, const std::size_t responseSize, void* responseData);
+        // Executes the commands recorded in a batch buffer, see OIV_CMD_ExecuteBatch_Request.
+        ResultCode ExecuteBatch(const OIV_CMD_ExecuteBatch_Request& request, OIV_CMD_ExecuteBatch_Response& response);
+        // Executes a command on a worker thread, see OIV_CMD_ExecuteAsync_Request.
+        ResultCode ExecuteAsync(const OIV_CMD_ExecuteAsync_Request& request, OIV_CMD_ExecuteAsync_Response& response);
+        ResultCode GetAsyncStatus(const OIV_CMD_GetAsyncStatus_Request& request, OIV_CMD_GetAsyncStatus_Response& response);
+        void RegisterCallbacks(const OIV_CMD_RegisterCallbacks_Request& callbacks);
+        // Blocks until all the asynchronous commands are done.
+        void WaitAsyncCommands();
+        ResultCode GetStatistics(const OIV_CMD_GetStatistics_Request& request, OIV_CMD_GetStatistics_Response& response) const;
+        void ResetStatistics();
     private: // methods
+        // Every command is executed through here, it records the latency of the command.
+        ResultCode ExecuteHandler(CommandExecute command, CommandHandler* handler, const std::size_t requestSize, const void* requestData, const std::size_t responseSize, void* responseData);
+        ThreadPool& GetThreadPool();
+        void CompleteAsyncCommand(OIV_Ticket ticket, ResultCode result);
         //bool IsInitialized() const;
 
     private: // member fields
         MapCommanderHandler fCommandHandlers;
+        CommandStatistics fStatistics;
+        std::mutex fAsyncMutex;
+        std::condition_variable fAsyncChanged;
+        MapTicketAsyncCommand fAsyncCommands;
+        OIV_Ticket fNextTicket = 1;
+        size_t fNumRunningAsyncCommands = 0;
+        OIV_CMD_RegisterCallbacks_Request fCallbacks = {};
+        std::once_flag fThreadPoolOnce;
+        // Declared last, destroying the pool completes the queued commands that use the members above.
+        std::unique_ptr<ThreadPool> fThreadPool;
 
     };
 }
@@ -0,0 +1,107 @@
+#include "CommandStatistics.h"
+#include <algorithm>
+#include <bit>
+
+namespace OIV
+{
+    uint32_t CommandStatistics::GetBucket(uint64_t timeNs)
+    {
+        // Values below SubBuckets map to themselves, above each power of two is split into SubBuckets buckets.
+        if (timeNs < SubBuckets)
+            return static_cast<uint32_t>(timeNs);
+
+        const uint32_t exponent = static_cast<uint32_t>(std::bit_width(timeNs)) - 1;
+        if (exponent > MaxExponent)
+            return NumBuckets - 1;
+
+        const uint32_t subBucket = static_cast<uint32_t>(timeNs >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+        return (exponent - SubBucketBits + 1) * SubBuckets + subBucket;
+    }
+
+    uint64_t CommandStatistics::GetBucketTime(uint32_t bucket)
+    {
+        if (bucket < SubBuckets)
+            return bucket;
+
+        const uint32_t exponent = bucket / SubBuckets + SubBucketBits - 1;
+        const uint64_t width = uint64_t{ 1 } << (exponent - SubBucketBits);
+        const uint64_t lowerBound = (uint64_t{ 1 } << exponent) + (bucket % SubBuckets) * width;
+        return lowerBound + width / 2;
+    }
+
+    void CommandStatistics::Record(CommandExecute command, uint64_t timeNs, ResultCode result, bool exception)
+    {
+        if (static_cast<uint32_t>(command) >= MaxCommands)
+            return;
+
+        Histogram& histogram = fHistograms[command];
+        histogram.count.fetch_add(1, std::memory_order_relaxed);
+        if (result != RC_Success)
+            histogram.errors.fetch_add(1, std::memory_order_relaxed);
+        if (exception)
+            histogram.exceptions.fetch_add(1, std::memory_order_relaxed);
+
+        histogram.totalTimeNs.fetch_add(timeNs, std::memory_order_relaxed);
+        histogram.buckets[GetBucket(timeNs)].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t maxTimeNs = histogram.maxTimeNs.load(std::memory_order_relaxed);
+        while (timeNs > maxTimeNs && histogram.maxTimeNs.compare_exchange_weak(maxTimeNs, timeNs, std::memory_order_relaxed) == false);
+    }
+
+    bool CommandStatistics::Get(CommandExecute command, OIV_Command_Statistics& statistics) const
+    {
+        if (static_cast<uint32_t>(command) >= MaxCommands)
+            return false;
+
+        const Histogram& histogram = fHistograms[command];
+        std::array<uint64_t, NumBuckets> buckets;
+        uint64_t count = 0;
+        for (uint32_t i = 0; i < NumBuckets; i++)
+        {
+            buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+            count += buckets[i];
+        }
+
+        if (count == 0)
+            return false;
+
+        // The percentiles are taken from the buckets, so they agree with each other even while commands are recorded.
+        auto getPercentile = [&buckets, count](uint64_t percentile) -> uint64_t
+        {
+            const uint64_t rank = std::max<uint64_t>((count * percentile + 99) / 100, 1);
+            uint64_t cumulative = 0;
+            for (uint32_t i = 0; i < NumBuckets; i++)
+            {
+                cumulative += buckets[i];
+                if (cumulative >= rank)
+                    return GetBucketTime(i);
+            }
+            return GetBucketTime(NumBuckets - 1);
+        };
+
+        statistics.command = command;
+        statistics.count = histogram.count.load(std::memory_order_relaxed);
+        statistics.errors = histogram.errors.load(std::memory_order_relaxed);
+        statistics.exceptions = histogram.exceptions.load(std::memory_order_relaxed);
+        statistics.totalTimeNs = histogram.totalTimeNs.load(std::memory_order_relaxed);
+        statistics.maxTimeNs = histogram.maxTimeNs.load(std::memory_order_relaxed);
+        statistics.p50TimeNs = std::min(getPercentile(50), statistics.maxTimeNs);
+        statistics.p90TimeNs = std::min(getPercentile(90), statistics.maxTimeNs);
+        statistics.p99TimeNs = std::min(getPercentile(99), statistics.maxTimeNs);
+        return true;
+    }
+
+    void CommandStatistics::Reset()
+    {
+        for (Histogram& histogram : fHistograms)
+        {
+            histogram.count.store(0, std::memory_order_relaxed);
+            histogram.errors.store(0, std::memory_order_relaxed);
+            histogram.exceptions.store(0, std::memory_order_relaxed);
+            histogram.totalTimeNs.store(0, std::memory_order_relaxed);
+            histogram.maxTimeNs.store(0, std::memory_order_relaxed);
+            for (std::atomic_uint64_t& bucket : histogram.buckets)
+                bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
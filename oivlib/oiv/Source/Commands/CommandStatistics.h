@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <defs.h>
+
+namespace OIV
+{
+    // Counts and latency histograms of the executed commands, recorded lock free from any thread.
+    // Latencies are bucketed log-linearly, 4 buckets per power of two, so a percentile is off by less than 12.5%.
+    class CommandStatistics
+    {
+    public:
+        static constexpr uint32_t MaxCommands = 64;
+
+        void Record(CommandExecute command, uint64_t timeNs, ResultCode result, bool exception);
+        // Returns false if the command was never executed.
+        bool Get(CommandExecute command, OIV_Command_Statistics& statistics) const;
+        // Commands executing meanwhile may be partially recorded.
+        void Reset();
+
+    private: // types
+        static constexpr uint32_t SubBucketBits = 2;
+        static constexpr uint32_t SubBuckets = 1 << SubBucketBits;
+        static constexpr uint32_t MaxExponent = 40; // Latencies from about 18 minutes go into the last bucket.
+        static constexpr uint32_t NumBuckets = (MaxExponent - SubBucketBits + 2) * SubBuckets;
+
+        struct Histogram
+        {
+            std::atomic_uint64_t count;
+            std::atomic_uint64_t errors;
+            std::atomic_uint64_t exceptions;
+            std::atomic_uint64_t totalTimeNs;
+            std::atomic_uint64_t maxTimeNs;
+            std::array<std::atomic_uint64_t, NumBuckets> buckets;
+        };
+
+    private: // methods
+        static uint32_t GetBucket(uint64_t timeNs);
+        // Middle of the range of latencies in the bucket.
+        static uint64_t GetBucketTime(uint32_t bucket);
+
+    private: // member fields
+        std::array<Histogram, MaxCommands> fHistograms = {};
+    };
+}
@@ -8,6 +8,9 @@ namespace OIV
 
     class CommandHandlerCropImage : public CommandHandler
     {
+    public:
+        bool IsConcurrent() const override { return true; }
+
     protected:
         ResultCode Verify(std::size_t requestSize, std::size_t responseSize) override
         {
@@ -10,6 +10,8 @@ namespace OIV
     protected:
         ResultCode ExecuteImpl(const void* request, const std::size_t requestSize, void* response, const std::size_t responseSize) override
         {
+            // Asynchronous commands use the picture renderer.
+            ApiGlobal::sCommandProcessor.WaitAsyncCommands();
             ApiGlobal::sPictureRenderer.reset();
             return RC_Success;
         }
@@ -0,0 +1,27 @@
+#pragma once
+#include "../CommandHandler.h"
+#include <defs.h>
+#include "../CommandProcessor.h"
+#include "../../ApiGlobal.h"
+
+namespace OIV
+{
+
+    class CommandHandlerExecuteBatch : public CommandHandler
+    {
+    protected:
+        ResultCode Verify(std::size_t requestSize, std::size_t responseSize) override
+        {
+            return VERIFY(OIV_CMD_ExecuteBatch_Request, requestSize, OIV_CMD_ExecuteBatch_Response, responseSize);
+        }
+
+        ResultCode ExecuteImpl(const void* request, const std::size_t requestSize, void* response, const std::size_t responseSize) override
+        {
+            const OIV_CMD_ExecuteBatch_Request* req = reinterpret_cast<const OIV_CMD_ExecuteBatch_Request*>(request);
+            OIV_CMD_ExecuteBatch_Response* res = reinterpret_cast<OIV_CMD_ExecuteBatch_Response*>(response);
+            return ApiGlobal::sCommandProcessor.ExecuteBatch(*req, *res);
+        }
+    };
+
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "../CommandHandler.h"
+#include <defs.h>
+#include "../CommandProcessor.h"
+#include "../../ApiGlobal.h"
+
+namespace OIV
+{
+
+    class CommandHandlerGetStatistics : public CommandHandler
+    {
+    public:
+        bool IsConcurrent() const override { return true; }
+
+    protected:
+        ResultCode Verify(std::size_t requestSize, std::size_t responseSize) override
+        {
+            return VERIFY(OIV_CMD_GetStatistics_Request, requestSize, OIV_CMD_GetStatistics_Response, responseSize);
+        }
+
+        ResultCode ExecuteImpl(const void* request, const std::size_t requestSize, void* response, const std::size_t responseSize) override
+        {
+            const OIV_CMD_GetStatistics_Request* req = reinterpret_cast<const OIV_CMD_GetStatistics_Request*>(request);
+            OIV_CMD_GetStatistics_Response* res = reinterpret_cast<OIV_CMD_GetStatistics_Response*>(response);
+            return ApiGlobal::sCommandProcessor.GetStatistics(*req, *res);
+        }
+    };
+
+
+}
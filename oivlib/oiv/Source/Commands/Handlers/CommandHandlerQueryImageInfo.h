@@ -9,6 +9,9 @@ namespace OIV
 
     class CommandHandlerQueryImageInfo : public CommandHandler
     {
+    public:
+        bool IsConcurrent() const override { return true; }
+
     protected:
         ResultCode Verify(std::size_t requestSize, std::size_t responseSize) override
         {
@@ -18,6 +18,7 @@ namespace OIV
         {
             ResultCode result = RC_Success;
             const OIV_CMD_RegisterCallbacks_Request* callbacks = reinterpret_cast<const OIV_CMD_RegisterCallbacks_Request*>(request);
+            ApiGlobal::sCommandProcessor.RegisterCallbacks(*callbacks);
             result = ApiGlobal::sPictureRenderer->RegisterCallbacks(*callbacks);
 
             return result;
@@ -9,6 +9,9 @@ namespace OIV
 
     class CommandHandlerResampleImage : public CommandHandler
     {
+    public:
+        bool IsConcurrent() const override { return true; }
+
     protected:
         ResultCode Verify(std::size_t requestSize, std::size_t responseSize) override
         {
@@ -23,8 +26,15 @@ namespace OIV
             {
                 const OIV_CMD_Resample_Request* req = reinterpret_cast<const OIV_CMD_Resample_Request*>(request);
                 OIV_CMD_Resample_Response* res = reinterpret_cast<OIV_CMD_Resample_Response*>(response);
-                result = ApiGlobal::sPictureRenderer->ResampleImage(*req, handle);
-                res->imageHandle = handle;
+                if (req->filter < RF_Box || req->filter >= RF_Count || req->size.x <= 0 || req->size.y <= 0)
+                {
+                    result = RC_InvalidParameters;
+                }
+                else
+                {
+                    result = ApiGlobal::sPictureRenderer->ResampleImage(*req, handle);
+                    res->imageHandle = handle;
+                }
             }
 
             return result;
@@ -0,0 +1,24 @@
+#pragma once
+#include "../CommandHandler.h"
+#include <defs.h>
+#include "../CommandProcessor.h"
+#include "../../ApiGlobal.h"
+
+namespace OIV
+{
+
+    class CommandHandlerResetStatistics : public CommandHandler
+    {
+    public:
+        bool IsConcurrent() const override { return true; }
+
+    protected:
+        ResultCode ExecuteImpl(const void* request, const std::size_t requestSize, void* response, const std::size_t responseSize) override
+        {
+            ApiGlobal::sCommandProcessor.ResetStatistics();
+            return RC_Success;
+        }
+    };
+
+
+}
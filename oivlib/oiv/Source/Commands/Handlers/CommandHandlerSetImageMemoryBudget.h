@@ -0,0 +1,25 @@
+#pragma once
+#include "../CommandHandler.h"
+#include <defs.h>
+#include "../CommandProcessor.h"
+
+namespace OIV
+{
+
+    class CommandHandlerSetImageMemoryBudget : public CommandHandler
+    {
+    protected:
+        ResultCode Verify(std::size_t requestSize, std::size_t responseSize) override
+        {
+            return VERIFY_REQUEST(OIV_CMD_SetImageMemoryBudget_Request, requestSize);
+        }
+
+        ResultCode ExecuteImpl(const void* request, const std::size_t requestSize, void* response, const std::size_t responseSize) override
+        {
+            const OIV_CMD_SetImageMemoryBudget_Request* req = reinterpret_cast<const OIV_CMD_SetImageMemoryBudget_Request*>(request);
+            return ApiGlobal::sPictureRenderer->SetImageMemoryBudget(*req);
+        }
+    };
+
+
+}
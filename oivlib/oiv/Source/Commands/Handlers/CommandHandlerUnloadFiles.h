@@ -0,0 +1,29 @@
+#pragma once
+#include "../CommandHandler.h"
+#include <defs.h>
+#include "../CommandProcessor.h"
+
+namespace OIV
+{
+
+    class CommandHandlerUnloadFiles : public CommandHandler
+    {
+    protected:
+        ResultCode Verify(std::size_t requestSize, std::size_t responseSize) override
+        {
+            return VERIFY_OPTIONAL_RESPONSE(OIV_CMD_UnloadFiles_Request, requestSize, OIV_CMD_UnloadFiles_Response, responseSize);
+        }
+
+        ResultCode ExecuteImpl(const void* request, const std::size_t requestSize, void* response, const std::size_t responseSize) override
+        {
+            const OIV_CMD_UnloadFiles_Request* req = reinterpret_cast<const OIV_CMD_UnloadFiles_Request*>(request);
+            uint32_t numUnloaded = 0;
+            ResultCode result = ApiGlobal::sPictureRenderer->UnloadFiles(req->handles, req->numHandles, numUnloaded);
+
+            if (result == RC_Success && responseSize == sizeof(OIV_CMD_UnloadFiles_Response))
+                reinterpret_cast<OIV_CMD_UnloadFiles_Response*>(response)->numUnloaded = numUnloaded;
+
+            return result;
+        }
+    };
+}
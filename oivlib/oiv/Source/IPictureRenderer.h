@@ -2,19 +2,32 @@
 #include <defs.h>
 #include <Image.h>
 #include <Interfaces/IRenderer.h>
+#include <functional>
 
 
 namespace OIV
 {
+    struct ResampleCancellation;
+
     class IPictureRenderer
     {
     public:
         virtual IRenderer* GetRenderer() = 0;
-        virtual IMCodec::ImageSharedPtr Resample(IMCodec::ImageSharedPtr sourceImage, LLUtils::PointI32 targetSize) = 0;
+        // Returns nullptr if the texel format isn't supported or the resample was cancelled.
+        virtual IMCodec::ImageSharedPtr Resample(IMCodec::ImageSharedPtr sourceImage, LLUtils::PointI32 targetSize, OIV_Resample_Filter filter, const OIV_RECT_I& targetRegion, const ResampleCancellation* cancellation = nullptr) = 0;
+        // Build a mip pyramid of an 8 bit RGBA image on a background thread, 'onReady' is invoked on that thread once it's built.
+        // Does nothing if the image is too small or of another texel format.
+        virtual void BuildMipPyramid(IMCodec::ImageSharedPtr image, std::function<void()> onReady) = 0;
+        // Discard the pending builds and stop the running one, once returned 'onReady' of a build requested before isn't invoked anymore.
+        virtual void CancelMipPyramidBuilds() = 0;
+        // The smallest built mip level at least 'minSize', nullptr if there is no such level.
+        virtual IMCodec::ImageSharedPtr GetMipLevel(IMCodec::ImageSharedPtr image, LLUtils::PointI32 minSize) = 0;
+        virtual size_t GetMipPyramidSizeInBytes(IMCodec::ImageSharedPtr image) = 0;
     
         virtual ResultCode LoadFile(void* buffer, std::size_t size, char* extension, OIV_CMD_LoadFile_Flags flags, ImageHandle& handle) = 0;
-        virtual ResultCode LoadRaw(const OIV_CMD_LoadRaw_Request& loadRawRequest, int16_t& handle) = 0;
+        virtual ResultCode LoadRaw(const OIV_CMD_LoadRaw_Request& loadRawRequest, ImageHandle& handle) = 0;
         virtual ResultCode UnloadFile(const ImageHandle handle) = 0;
+        virtual ResultCode UnloadFiles(const ImageHandle* handles, uint32_t numHandles, uint32_t& numUnloaded) = 0;
         //virtual ResultCode DisplayFile(const OIV_CMD_DisplayImage_Request& display_request) = 0;
         virtual ResultCode CreateText(const OIV_CMD_CreateText_Request&, OIV_CMD_CreateText_Response&) = 0;
 
@@ -42,6 +55,9 @@ namespace OIV
 
         virtual ResultCode RegisterCallbacks(const OIV_CMD_RegisterCallbacks_Request& callbacks) = 0;
         virtual ResultCode ResampleImage(const OIV_CMD_Resample_Request&, ImageHandle&) = 0;
+        virtual ResultCode GetResamplerStatistics(OIV_CMD_GetResamplerStatistics_Response& res) = 0;
+        virtual ResultCode SetImageMemoryBudget(const OIV_CMD_SetImageMemoryBudget_Request& req) = 0;
+        virtual ResultCode GetImageMemoryStatistics(OIV_CMD_GetImageMemoryStatistics_Response& res) = 0;
         virtual ResultCode SetBackgroundColor(int index, LLUtils::Color backgroundColor) = 0;
     };
 }
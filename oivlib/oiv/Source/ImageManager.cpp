@@ -1,122 +1,361 @@
 #include "ImageManager.h"
+#include <algorithm>
+#include <mutex>
 #include <LLUtils/Exception.h>
 
 namespace OIV
 {
-    ImageManager::ImageManager()
+    std::size_t ImageManager::GetNumLoadedImages() const
     {
-        for (int16_t i = MAX_IMAGES + 1; i >= 1; i--)
-            fListFreeHandles.push_back(static_cast<ImageHandle>(i));
+        std::shared_lock lock(fMutex);
+        return fNumLoadedImages;
     }
 
-    std::size_t ImageManager::GetNumLoadedImages() const
+    ImageHandle ImageManager::MakeHandle(uint32_t index, uint32_t generation)
     {
-        return MAX_IMAGES - GetNumImagesVacancy();
+        return static_cast<ImageHandle>(generation << IndexBits | index);
     }
 
-    std::size_t ImageManager::GetNumImagesVacancy() const
+    size_t ImageManager::GetSizeInBytes(const IMCodec::ImageSharedPtr& image)
     {
-        return fListFreeHandles.size();
+        return image->GetRowPitchInBytes() * image->GetHeight();
     }
 
-    ImageHandle ImageManager::AllocateImageHandle()
+    ImageManager::Slot* ImageManager::FindSlot(ImageHandle handle)
     {
-        ImageHandle handle = fListFreeHandles.back();
-        fListFreeHandles.pop_back();
-        return handle;
+        return const_cast<Slot*>(static_cast<const ImageManager*>(this)->FindSlot(handle));
     }
 
-    void ImageManager::DeallocateHandle(ImageHandle handle)
+    const ImageManager::Slot* ImageManager::FindSlot(ImageHandle handle) const
     {
-        fListFreeHandles.push_back(handle);
+        const uint32_t index = handle & MaxSlots;
+        const uint32_t generation = handle >> IndexBits;
+        if (handle == ImageHandleNull || index >= fSlots.size())
+            return nullptr;
+
+        const Slot& slot = fSlots[index];
+        return slot.generation == generation && (slot.image != nullptr || slot.isEvicted) ? &slot : nullptr;
     }
 
-    ImageHandle ImageManager::AddImage(const IMCodec::ImageSharedPtr& image)
+    void ImageManager::LinkMostRecent(uint32_t index)
     {
-        if (GetNumImagesVacancy() > 0)
+        Slot& slot = fSlots[index];
+        slot.lruPrevious = NullIndex;
+        slot.lruNext = fMostRecent;
+        if (fMostRecent != NullIndex)
+            fSlots[fMostRecent].lruPrevious = index;
+        else
+            fLeastRecent = index;
+
+        fMostRecent = index;
+    }
+
+    void ImageManager::Unlink(uint32_t index)
+    {
+        Slot& slot = fSlots[index];
+        if (slot.lruPrevious != NullIndex)
+            fSlots[slot.lruPrevious].lruNext = slot.lruNext;
+        else
+            fMostRecent = slot.lruNext;
+
+        if (slot.lruNext != NullIndex)
+            fSlots[slot.lruNext].lruPrevious = slot.lruPrevious;
+        else
+            fLeastRecent = slot.lruPrevious;
+
+        slot.lruPrevious = NullIndex;
+        slot.lruNext = NullIndex;
+    }
+
+    void ImageManager::SetSlotImage(uint32_t index, IMCodec::ImageSharedPtr image)
+    {
+        Slot& slot = fSlots[index];
+        slot.sizeInBytes = GetSizeInBytes(image);
+        slot.image = std::move(image);
+        fSizeInBytes += slot.sizeInBytes;
+        fPeakSizeInBytes = std::max(fPeakSizeInBytes, fSizeInBytes);
+        if (slot.recreate != nullptr)
         {
-            auto pair = fMapHandleToImage.insert(std::make_pair(AllocateImageHandle(), image));
-            if (pair.second == false)
-                LL_EXCEPTION(LLUtils::Exception::ErrorCode::DuplicateItem, "Image manager, duplicate image found");
+            slot.referenced.value.store(true, std::memory_order_relaxed);
+            LinkMostRecent(index);
+        }
+    }
+
+    void ImageManager::ReleaseSlotImage(uint32_t index)
+    {
+        Slot& slot = fSlots[index];
+        if (slot.recreate != nullptr)
+            Unlink(index);
+
+        fSizeInBytes -= slot.sizeInBytes;
+        slot.sizeInBytes = 0;
+        slot.image.reset();
+    }
 
-            return pair.first->first;
+    void ImageManager::EvictOverBudget()
+    {
+        while (fSizeInBytes > fBudgetInBytes && fLeastRecent != NullIndex && fLeastRecent != fMostRecent)
+        {
+            const uint32_t index = fLeastRecent;
+            Slot& slot = fSlots[index];
+            if (slot.referenced.value.exchange(false, std::memory_order_relaxed))
+            {
+                // Resolved since it was last moved, give it a second chance.
+                Unlink(index);
+                LinkMostRecent(index);
+                continue;
+            }
+
+            slot.evicted = slot.image;
+            ReleaseSlotImage(index);
+            slot.isEvicted = true;
+            fNumEvictedImages++;
+            fEvictions++;
+        }
+    }
+
+    ImageHandle ImageManager::AddImage(const IMCodec::ImageSharedPtr& image, RecreateFunc recreate)
+    {
+        std::unique_lock lock(fMutex);
+        return AddImageLocked(image, std::move(recreate));
+    }
+
+    uint32_t ImageManager::AllocateSlot()
+    {
+        uint32_t index = NullIndex;
+        if (fFreeSlots.empty() == false)
+        {
+            index = fFreeSlots.back();
+            fFreeSlots.pop_back();
+        }
+        else if (fSlots.size() < MaxSlots)
+        {
+            index = static_cast<uint32_t>(fSlots.size());
+            fSlots.emplace_back();
         }
+        return index;
+    }
+
+    ImageHandle ImageManager::AddImageLocked(const IMCodec::ImageSharedPtr& image, RecreateFunc recreate)
+    {
+        if (image == nullptr)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Image manager, null image");
+
+        const uint32_t index = AllocateSlot();
+        if (index == NullIndex)
+            return ImageHandleNull;
 
-        return ImageHandleNull;
+        fSlots[index].recreate = std::move(recreate);
+        SetSlotImage(index, image);
+        fNumLoadedImages++;
+        EvictOverBudget();
+        return MakeHandle(index, fSlots[index].generation);
     }
 
-    ImageHandle ImageManager::AddChildImage(const IMCodec::ImageSharedPtr& image,ImageHandle parent)
+    ImageHandle ImageManager::AddChildImage(const IMCodec::ImageSharedPtr& image, ImageHandle parent)
     {
-        IMCodec::ImageSharedPtr parentImage = GetImage(parent);
-        if (parentImage == nullptr)
+        std::unique_lock lock(fMutex);
+        if (FindSlot(parent) == nullptr)
             LL_EXCEPTION(LLUtils::Exception::ErrorCode::DuplicateItem, "Image manager, parent image not found");
 
-        ImageHandle childHandle = AddImage(image);
-        fMapHandleToChildren[parent].push_back(childHandle);
+        const ImageHandle childHandle = AddImageLocked(image, nullptr);
+        // Adding may grow the slots, look up the parent again.
+        if (childHandle != ImageHandleNull)
+        {
+            FindSlot(parent)->children.push_back(childHandle);
+            fSlots[childHandle & MaxSlots].parent = parent;
+        }
+
         return childHandle;
     }
 
+    ImageHandle ImageManager::AddLazyChildImage(RecreateFunc load, ImageHandle parent, const IMCodec::ImageSharedPtr& loadSource)
+    {
+        if (load == nullptr)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Image manager, null image loader");
+
+        std::unique_lock lock(fMutex);
+        if (FindSlot(parent) == nullptr)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::DuplicateItem, "Image manager, parent image not found");
+
+        const uint32_t index = AllocateSlot();
+        if (index == NullIndex)
+            return ImageHandleNull;
+
+        // Loaded the same way an evicted image is recreated.
+        Slot& slot = fSlots[index];
+        slot.recreate = std::move(load);
+        slot.isEvicted = true;
+        slot.parent = parent;
+        slot.recreateSizeInBytes = loadSource != nullptr ? GetSizeInBytes(loadSource) : 0;
+        fSizeInBytes += slot.recreateSizeInBytes;
+        fPeakSizeInBytes = std::max(fPeakSizeInBytes, fSizeInBytes);
+        fNumEvictedImages++;
+        fNumLoadedImages++;
+
+        const ImageHandle childHandle = MakeHandle(index, slot.generation);
+        // Adding may grow the slots, look up the parent again.
+        FindSlot(parent)->children.push_back(childHandle);
+        return childHandle;
+    }
 
     bool ImageManager::RemoveImage(ImageHandle handle)
     {
-        auto it = fMapHandleToImage.find(handle);
-        if (it != fMapHandleToImage.end())
+        std::unique_lock lock(fMutex);
+        return RemoveImageLocked(handle);
+    }
+
+    size_t ImageManager::RemoveImages(const ImageHandle* handles, size_t numHandles, std::vector<IMCodec::ImageSharedPtr>& removedImages)
+    {
+        std::unique_lock lock(fMutex);
+        size_t numRemoved = 0;
+        for (size_t i = 0; i < numHandles; i++)
         {
-            RemoveChildren(handle);
-            DeallocateHandle(handle);
-            fMapHandleToImage.erase(it);
-            return true;
+            if (RemoveImageLocked(handles[i], &removedImages))
+                numRemoved++;
         }
-        return false;
+        return numRemoved;
     }
 
-
-    bool ImageManager::RemoveChildren(ImageHandle handle)
+    bool ImageManager::RemoveImageLocked(ImageHandle handle, std::vector<IMCodec::ImageSharedPtr>* removedImages)
     {
-        auto it = fMapHandleToChildren.find(handle);
+        Slot* slot = FindSlot(handle);
+        if (slot == nullptr)
+            return false;
 
-        if (it != fMapHandleToChildren.end())
-        {
-            auto& children = it->second;
-            for (ImageHandle handle : children)
-                RemoveImage(handle);
+        RemoveChildren(*slot, removedImages);
+        // Removing the children doesn't add slots, the pointer is still valid.
+        const uint32_t index = handle & MaxSlots;
 
-            fMapHandleToChildren.erase(it);
+        // A child removed on its own is taken out of its parent's children, a parent being removed has already cleared them.
+        if (Slot* parentSlot = FindSlot(slot->parent); parentSlot != nullptr)
+            std::erase(parentSlot->children, handle);
+        slot->parent = ImageHandleNull;
+        if (removedImages != nullptr)
+        {
+            IMCodec::ImageSharedPtr image = slot->isEvicted ? slot->evicted.lock() : slot->image;
+            if (image != nullptr)
+                removedImages->push_back(std::move(image));
         }
+
+        if (slot->isEvicted)
+            fNumEvictedImages--;
         else
+            ReleaseSlotImage(index);
+
+        slot->recreate = nullptr;
+        fSizeInBytes -= slot->recreateSizeInBytes;
+        slot->recreateSizeInBytes = 0;
+        slot->evicted.reset();
+        slot->isEvicted = false;
+        fNumLoadedImages--;
+
+        // A slot that ran out of generations is retired, reusing it would make old handles valid again.
+        if (slot->generation < MaxGeneration)
         {
-            return false;
+            slot->generation++;
+            fFreeSlots.push_back(index);
         }
-
         return true;
     }
 
-    IMCodec::ImageSharedPtr ImageManager::GetImage(ImageHandle handle) const
+    void ImageManager::RemoveChildren(Slot& slot, std::vector<IMCodec::ImageSharedPtr>* removedImages)
     {
-        IMCodec::ImageSharedPtr image = nullptr;
-        if (handle != ImageHandleNull)
+        VecImageHandles children = std::move(slot.children);
+        slot.children.clear();
+        for (ImageHandle child : children)
+            RemoveImageLocked(child, removedImages);
+    }
+
+    IMCodec::ImageSharedPtr ImageManager::GetImage(ImageHandle handle)
+    {
+        RecreateFunc recreate;
+        IMCodec::ImageSharedPtr image;
         {
-            auto it = fMapHandleToImage.find(handle);
-            if (it != fMapHandleToImage.end())
-                image = it->second;
+            std::shared_lock lock(fMutex);
+            const Slot* slot = FindSlot(handle);
+            if (slot == nullptr)
+                return nullptr;
+
+            if (slot->isEvicted == false)
+            {
+                slot->referenced.value.store(true, std::memory_order_relaxed);
+                return slot->image;
+            }
+
+            image = slot->evicted.lock();
+            if (image == nullptr)
+                recreate = slot->recreate;
         }
 
+        // Recreate without holding the lock, recreating resolves the source handle and may take long.
+        if (image == nullptr)
+            image = recreate();
+
+        std::unique_lock lock(fMutex);
+        Slot* slot = FindSlot(handle);
+        if (slot == nullptr)
+            return image; // Removed meanwhile.
+        if (slot->isEvicted == false)
+            return slot->image; // Restored meanwhile.
+        if (image == nullptr)
+            return nullptr;
+
+        if (recreate != nullptr)
+            fRecreations++;
+
+        slot->isEvicted = false;
+        slot->evicted.reset();
+        fNumEvictedImages--;
+        SetSlotImage(handle & MaxSlots, image);
+        EvictOverBudget();
         return image;
     }
 
     void ImageManager::ReplaceImage(ImageHandle handle, IMCodec::ImageSharedPtr image)
     {
-        RemoveChildren(handle);
-        fMapHandleToImage[handle] = image;
+        std::unique_lock lock(fMutex);
+        Slot* slot = FindSlot(handle);
+        if (slot == nullptr || image == nullptr)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Image manager, invalid image handle");
+
+        RemoveChildren(*slot);
+        const uint32_t index = handle & MaxSlots;
+        if (slot->isEvicted)
+        {
+            slot->isEvicted = false;
+            slot->evicted.reset();
+            fNumEvictedImages--;
+        }
+        else
+        {
+            ReleaseSlotImage(index);
+        }
+
+        // The new image has no known way to be recreated.
+        slot->recreate = nullptr;
+        fSizeInBytes -= slot->recreateSizeInBytes;
+        slot->recreateSizeInBytes = 0;
+        SetSlotImage(index, std::move(image));
+    }
+
+    ImageManager::VecImageHandles ImageManager::GetChildrenOf(ImageHandle handle) const
+    {
+        std::shared_lock lock(fMutex);
+        const Slot* slot = FindSlot(handle);
+        return slot != nullptr ? slot->children : VecImageHandles();
     }
 
-    ImageManager::VecImageHandles ImageManager::GetChildrenOf(ImageHandle handle)
+    void ImageManager::SetBudget(size_t budgetInBytes)
     {
-        auto it = fMapHandleToChildren.find(handle);
+        std::unique_lock lock(fMutex);
+        fBudgetInBytes = budgetInBytes;
+        EvictOverBudget();
+    }
 
-        if (it != fMapHandleToChildren.end())
-            return it->second;
-        else
-            return VecImageHandles();
+    ImageManager::Statistics ImageManager::GetStatistics() const
+    {
+        std::shared_lock lock(fMutex);
+        return { fNumLoadedImages, fNumEvictedImages, fSizeInBytes, fPeakSizeInBytes, fBudgetInBytes, fEvictions, fRecreations };
     }
 }
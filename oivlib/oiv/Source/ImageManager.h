@@ -1,39 +1,129 @@
 #pragma once
-#include <list>
-#include <map>
+#include <atomic>
+#include <functional>
+#include <shared_mutex>
+#include <vector>
 #include <defs.h>
 #include <Image.h>
 
 
 namespace OIV
 {
+    // Images are held in a slot map, handles are O(1) to add, remove and resolve.
+    // A removed slot is reused with the next generation, so handles of removed images are rejected.
+    // Images that can be recreated are evicted least recently used first when the images exceed the memory budget,
+    // the handle of an evicted image stays valid and resolving it recreates the image.
+    // Thread safe, handles are resolved concurrently under a shared lock and changes are serialized under an exclusive lock.
+    // Returned images are shared, an image removed or evicted meanwhile stays alive while referenced.
     class ImageManager
     {
     public:
-        const int16_t MAX_IMAGES = 100;
         using VecImageHandles = std::vector<ImageHandle>;
-        typedef std::list<ImageHandle> ListImageHandles;
-        typedef std::map<ImageHandle,IMCodec::ImageSharedPtr> MapHandleToImage;
-        using MapHandleToChildren = std::map<ImageHandle, VecImageHandles>;
-        ImageManager();
+        // Returns nullptr if the image can no longer be recreated, e.g. its source image was removed.
+        using RecreateFunc = std::function<IMCodec::ImageSharedPtr()>;
+
+        static constexpr uint32_t IndexBits = 20;
+        static constexpr uint32_t GenerationBits = 32 - IndexBits;
+        static constexpr uint32_t MaxSlots = (1u << IndexBits) - 1;
+        static constexpr uint32_t MaxGeneration = (1u << GenerationBits) - 1;
+        static constexpr size_t DefaultBudgetInBytes = size_t{ 1024 } * 1024 * 1024;
+
+        struct Statistics
+        {
+            size_t numImages;
+            size_t numEvictedImages; // Images currently evicted, counted in numImages.
+            size_t sizeInBytes; // Images held in memory, including the sources held by loaders of lazy images.
+            size_t peakSizeInBytes;
+            size_t budgetInBytes;
+            uint64_t evictions;
+            uint64_t recreations;
+        };
+
         std::size_t GetNumLoadedImages() const;
-        std::size_t GetNumImagesVacancy() const;
-        ImageHandle AddImage(const IMCodec::ImageSharedPtr& image);
+        // Returns ImageHandleNull when all slots are in use.
+        // Images with a recreate function may be evicted when over the memory budget.
+        ImageHandle AddImage(const IMCodec::ImageSharedPtr& image, RecreateFunc recreate = nullptr);
         ImageHandle AddChildImage(const IMCodec::ImageSharedPtr& image, ImageHandle parent);
+        // The image is created by 'load' when the handle is first resolved, until then it counts as evicted.
+        // 'loadSource' is an image held by 'load', it's counted in the memory held until the child is removed.
+        ImageHandle AddLazyChildImage(RecreateFunc load, ImageHandle parent, const IMCodec::ImageSharedPtr& loadSource = nullptr);
         bool RemoveImage(ImageHandle handle);
-        IMCodec::ImageSharedPtr GetImage(ImageHandle handle) const;
+        // Removes the images and their children under a single lock, returns the number of handles removed.
+        // Removed images that are still alive, in memory or referenced elsewhere, are appended to 'removedImages'.
+        size_t RemoveImages(const ImageHandle* handles, size_t numHandles, std::vector<IMCodec::ImageSharedPtr>& removedImages);
+        // Recreates the image if it was evicted.
+        IMCodec::ImageSharedPtr GetImage(ImageHandle handle);
         void ReplaceImage(ImageHandle handle, IMCodec::ImageSharedPtr image);
-        VecImageHandles GetChildrenOf(ImageHandle handle);
+        VecImageHandles GetChildrenOf(ImageHandle handle) const;
+        void SetBudget(size_t budgetInBytes);
+        Statistics GetStatistics() const;
 
     private: //methods
-        ImageHandle AllocateImageHandle();
-        void DeallocateHandle(ImageHandle handle);
-        bool RemoveChildren(ImageHandle handle);
-        
+        static constexpr uint32_t NullIndex = MaxSlots;
+
+        // Set by readers under the shared lock, copied when the slots grow under the exclusive lock.
+        struct ReferencedFlag
+        {
+            mutable std::atomic_bool value = false;
+
+            ReferencedFlag() = default;
+            ReferencedFlag(const ReferencedFlag& rhs) : value(rhs.value.load(std::memory_order_relaxed)) {}
+            ReferencedFlag& operator=(const ReferencedFlag& rhs)
+            {
+                value.store(rhs.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                return *this;
+            }
+        };
+
+        struct Slot
+        {
+            IMCodec::ImageSharedPtr image;
+            VecImageHandles children;
+            ImageHandle parent = ImageHandleNull;
+            RecreateFunc recreate;
+            // An evicted image may still be alive elsewhere, e.g. in the renderer, then it is taken back instead of recreated.
+            std::weak_ptr<IMCodec::Image> evicted;
+            size_t sizeInBytes = 0;
+            size_t recreateSizeInBytes = 0; // Held by 'recreate', can't be evicted.
+            // Least recently used list of the recreatable images held in memory, ordered by changes only.
+            // Resolving a handle only sets 'referenced', eviction gives a referenced image a second chance by moving it to the front.
+            ReferencedFlag referenced;
+            uint32_t lruPrevious = NullIndex;
+            uint32_t lruNext = NullIndex;
+            uint32_t generation = 1; // Generation 0 is never used, so no handle equals ImageHandleNull.
+            bool isEvicted = false;
+        };
+
+        static ImageHandle MakeHandle(uint32_t index, uint32_t generation);
+        static size_t GetSizeInBytes(const IMCodec::ImageSharedPtr& image);
+        // Methods below expect the caller to hold the lock.
+        // Returns nullptr if the handle is null, stale or out of range.
+        Slot* FindSlot(ImageHandle handle);
+        const Slot* FindSlot(ImageHandle handle) const;
+        // Returns NullIndex when all slots are in use.
+        uint32_t AllocateSlot();
+        ImageHandle AddImageLocked(const IMCodec::ImageSharedPtr& image, RecreateFunc recreate);
+        bool RemoveImageLocked(ImageHandle handle, std::vector<IMCodec::ImageSharedPtr>* removedImages = nullptr);
+        void RemoveChildren(Slot& slot, std::vector<IMCodec::ImageSharedPtr>* removedImages = nullptr);
+        void SetSlotImage(uint32_t index, IMCodec::ImageSharedPtr image);
+        void ReleaseSlotImage(uint32_t index);
+        void LinkMostRecent(uint32_t index);
+        void Unlink(uint32_t index);
+        // Never evicts the most recently used image.
+        void EvictOverBudget();
 
     private: // member fields
-        MapHandleToChildren fMapHandleToChildren;
-        MapHandleToImage fMapHandleToImage;
-        ListImageHandles fListFreeHandles;
+        mutable std::shared_mutex fMutex;
+        std::vector<Slot> fSlots;
+        std::vector<uint32_t> fFreeSlots;
+        std::size_t fNumLoadedImages = 0;
+        std::size_t fNumEvictedImages = 0;
+        uint32_t fMostRecent = NullIndex;
+        uint32_t fLeastRecent = NullIndex;
+        size_t fBudgetInBytes = DefaultBudgetInBytes;
+        size_t fSizeInBytes = 0;
+        size_t fPeakSizeInBytes = 0;
+        uint64_t fEvictions = 0;
+        uint64_t fRecreations = 0;
     };
 }
@@ -0,0 +1,93 @@
+#include "MipPyramid.h"
+#include "Resampler.h"
+
+namespace OIV
+{
+    namespace
+    {
+        IMCodec::ImageSharedPtr CreateLevel(const IMCodec::ImageSharedPtr& source, uint32_t width, uint32_t height)
+        {
+            using namespace IMCodec;
+            ImageItemSharedPtr imageItem = std::make_shared<ImageItem>();
+            ImageDescriptor& desc = imageItem->descriptor;
+            desc.width = width;
+            desc.height = height;
+            desc.rowPitchInBytes = width * source->GetBytesPerTexel();
+            desc.texelFormatDecompressed = source->GetTexelFormat();
+            desc.texelFormatStorage = source->GetOriginalTexelFormat();
+            imageItem->data.Allocate(desc.rowPitchInBytes * height);
+            return std::make_shared<Image>(imageItem, ImageItemType::Unknown);
+        }
+    }
+
+    bool MipPyramid::IsSupported(const IMCodec::ImageSharedPtr& image)
+    {
+        using namespace IMCodec;
+        switch (image->GetTexelFormat())
+        {
+        case TexelFormat::I_R8_G8_B8_A8:
+        case TexelFormat::I_B8_G8_R8_A8:
+        case TexelFormat::I_A8_R8_G8_B8:
+        case TexelFormat::I_A8_B8_G8_R8:
+            return image->GetItemType() != ImageItemType::Container
+                && (image->GetWidth() >= MinSourceDimension || image->GetHeight() >= MinSourceDimension);
+        default:
+            return false;
+        }
+    }
+
+    std::shared_ptr<const MipPyramid> MipPyramid::Create(const IMCodec::ImageSharedPtr& image, SimdLevel simdLevel
+        , const ResampleCancellation* cancellation)
+    {
+        const Average2x2Func average2x2 = ResamplerKernels::Get(simdLevel).average2x2;
+        auto pyramid = std::make_shared<MipPyramid>();
+
+        IMCodec::ImageSharedPtr previous = image;
+        while (previous->GetWidth() / 2 >= MinLevelDimension && previous->GetHeight() / 2 >= MinLevelDimension)
+        {
+            if (cancellation != nullptr && cancellation->IsCancelled())
+                return nullptr;
+
+            // An odd last column or row of the previous level is left out, shifting the level by less than a texel of the previous level.
+            const uint32_t width = previous->GetWidth() / 2;
+            const uint32_t height = previous->GetHeight() / 2;
+            IMCodec::ImageSharedPtr level = CreateLevel(previous, width, height);
+
+            const uint8_t* sourceBuffer = reinterpret_cast<const uint8_t*>(previous->GetBufferAt(0, 0));
+            const size_t sourceRowPitch = previous->GetRowPitchInBytes();
+            uint8_t* targetBuffer = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(level->GetBufferAt(0, 0)));
+            const size_t targetRowPitch = level->GetRowPitchInBytes();
+
+            for (uint32_t y = 0; y < height; y++)
+            {
+                const uint8_t* sourceRow0 = sourceBuffer + (y * 2) * sourceRowPitch;
+                average2x2(sourceRow0, sourceRow0 + sourceRowPitch, width, targetBuffer + y * targetRowPitch);
+            }
+
+            pyramid->fLevels.push_back(level);
+            previous = level;
+        }
+
+        return pyramid;
+    }
+
+    IMCodec::ImageSharedPtr MipPyramid::FindLevel(uint32_t minWidth, uint32_t minHeight) const
+    {
+        IMCodec::ImageSharedPtr result;
+        for (const IMCodec::ImageSharedPtr& level : fLevels)
+        {
+            if (level->GetWidth() < minWidth || level->GetHeight() < minHeight)
+                break;
+            result = level;
+        }
+        return result;
+    }
+
+    size_t MipPyramid::GetSizeInBytes() const
+    {
+        size_t sizeInBytes = 0;
+        for (const IMCodec::ImageSharedPtr& level : fLevels)
+            sizeInBytes += level->GetTotalSizeOfImageTexels();
+        return sizeInBytes;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <Image.h>
+#include "ResamplerKernels.h"
+
+namespace OIV
+{
+    struct ResampleCancellation;
+
+    // Successive 2x reductions of an 8 bit RGBA image, level 0 is the image itself and isn't held by the pyramid.
+    class MipPyramid
+    {
+    public:
+        // Smaller images are resampled fast enough from full resolution.
+        static constexpr uint32_t MinSourceDimension = 1024;
+        // Levels are reduced until the next one would be smaller than this on either axis.
+        static constexpr uint32_t MinLevelDimension = 64;
+
+        static bool IsSupported(const IMCodec::ImageSharedPtr& image);
+        // Returns nullptr if cancelled, checked between levels.
+        static std::shared_ptr<const MipPyramid> Create(const IMCodec::ImageSharedPtr& image, SimdLevel simdLevel = SimdLevel::Best
+            , const ResampleCancellation* cancellation = nullptr);
+
+        // Levels 1 and up.
+        const std::vector<IMCodec::ImageSharedPtr>& GetLevels() const { return fLevels; }
+        // The smallest level at least minWidth x minHeight texels, nullptr if only the image itself is large enough.
+        IMCodec::ImageSharedPtr FindLevel(uint32_t minWidth, uint32_t minHeight) const;
+        size_t GetSizeInBytes() const;
+
+    private:
+        std::vector<IMCodec::ImageSharedPtr> fLevels;
+    };
+}
@@ -90,18 +90,23 @@ namespace OIV
 			if (image != nullptr)
 			{
 				ItemMetaDataSharedPtr metaData;
+				unsigned short exifOrientation = 0;
 				if (imageCodec->LoadMetaData(fFileName, metaData) == ImageResult::Success)
 				{
-					auto exifOrientation = metaData->exifData.orientation;
+					exifOrientation = metaData->exifData.orientation;
 					if (exifOrientation > 1)
 					{
 						// I see no use of using the original image, discard source image and use the image with exif rotation applied. 
 						// If needed, responsibility for exif rotation can be transferred to the user by returning MetaData.exifOrientation.
 						image = ApplyExifRotation(image, exifOrientation);
 					}
+				}
 
-					for (uint16_t i = 0; i < image->GetNumSubImages(); i++)
-						image->SetSubImage(i, ApplyExifRotation(image->GetSubImage(i), exifOrientation));
+				{
+					// Orienting every page of a multi-page file up front costs a copy per page, orient in GetSubImage instead.
+					std::lock_guard<std::mutex> lock(fSubImagesMutex);
+					fExifOrientation = exifOrientation;
+					fOrientedSubImages.assign(image->GetNumSubImages(), nullptr);
 				}
 
 				SetMetaData(metaData);
@@ -111,4 +116,17 @@ namespace OIV
 		}
 		return result;
     }
- }
\ No newline at end of file
+ 
+	IMCodec::ImageSharedPtr OIVFileImage::GetSubImage(uint16_t index)
+	{
+		std::lock_guard<std::mutex> lock(fSubImagesMutex);
+		if (fExifOrientation <= 1)
+			return OIVBaseImage::GetSubImage(index);
+
+		IMCodec::ImageSharedPtr& subImage = fOrientedSubImages.at(index);
+		if (subImage == nullptr)
+			subImage = ApplyExifRotation(GetImage()->GetSubImage(index), fExifOrientation);
+
+		return subImage;
+	}
+}
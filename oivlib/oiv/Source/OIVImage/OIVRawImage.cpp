@@ -4,7 +4,7 @@
 
 namespace OIV
 {
-    ResultCode OIVRawImage::Load(const RawBufferParams& loadParams, const IMUtil::AxisAlignedTransform& transform)
+    IMCodec::ImageSharedPtr OIVRawImage::CreateImage(const RawBufferParams& loadParams, const IMUtil::AxisAlignedTransform& transform)
     {
         using namespace IMCodec;
         ImageItemSharedPtr imageItem = std::make_shared<ImageItem>();
@@ -16,16 +16,35 @@ namespace OIV
         props.texelFormatStorage = loadParams.texelFormat;
         props.texelFormatDecompressed = loadParams.texelFormat;
         props.rowPitchInBytes = loadParams.rowPitch;
-        const size_t bufferSize = props.rowPitchInBytes * props.height;
+        const size_t bufferSize = static_cast<size_t>(props.rowPitchInBytes) * props.height;
         imageItem->data.Allocate(bufferSize);
-        imageItem->data.Write(loadParams.buffer, 0, bufferSize);
+
+        // A vertical flip is applied while copying the rows, so the buffer is copied once and Transform has nothing left to do.
+        IMUtil::AxisAlignedTransform remainingTransform = transform;
+        if (transform.rotation == IMUtil::AxisAlignedRotation::None && transform.flip == IMUtil::AxisAlignedFlip::Vertical)
+        {
+            const size_t rowPitch = props.rowPitchInBytes;
+            for (uint32_t y = 0; y < props.height; y++)
+                imageItem->data.Write(loadParams.buffer + (props.height - 1 - y) * rowPitch, y * rowPitch, rowPitch);
+
+            remainingTransform.flip = IMUtil::AxisAlignedFlip::None;
+        }
+        else
+        {
+            imageItem->data.Write(loadParams.buffer, 0, bufferSize);
+        }
 
         ImageSharedPtr image = std::make_shared<Image>(imageItem, ImageItemType::Unknown);
-        image = IMUtil::ImageUtil::Transform(transform, image);
-        SetUnderlyingImage(image);
-        
-        return RC_Success;
+        // Transform copies the image even for the identity transform.
+        if (remainingTransform.rotation != IMUtil::AxisAlignedRotation::None || remainingTransform.flip != IMUtil::AxisAlignedFlip::None)
+            image = IMUtil::ImageUtil::Transform(remainingTransform, image);
 
+        return image;
+    }
 
+    ResultCode OIVRawImage::Load(const RawBufferParams& loadParams, const IMUtil::AxisAlignedTransform& transform)
+    {
+        SetUnderlyingImage(CreateImage(loadParams, transform));
+        return RC_Success;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,98 @@
+#include "ResampleTileCache.h"
+
+namespace OIV
+{
+    ResampleTileCache::TileData ResampleTileCache::Find(const TileKey& key, const std::shared_ptr<const void>& source)
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto it = fIndex.find(key);
+        if (it == fIndex.end())
+        {
+            fMisses++;
+            return nullptr;
+        }
+
+        EntryList::iterator entry = it->second;
+        if (entry->source.lock() != source)
+        {
+            // The source image has been released and another image took its address.
+            fSizeInBytes -= entry->data->size();
+            fEntries.erase(entry);
+            fIndex.erase(it);
+            fMisses++;
+            return nullptr;
+        }
+
+        fEntries.splice(fEntries.begin(), fEntries, entry);
+        fHits++;
+        return entry->data;
+    }
+
+    void ResampleTileCache::Insert(const TileKey& key, const std::shared_ptr<const void>& source, TileData data)
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto it = fIndex.find(key);
+        if (it != fIndex.end())
+        {
+            fSizeInBytes -= it->second->data->size();
+            fEntries.erase(it->second);
+            fIndex.erase(it);
+        }
+
+        fSizeInBytes += data->size();
+        fEntries.push_front(Entry{ key, source, std::move(data) });
+        fIndex.emplace(key, fEntries.begin());
+        EvictOverBudget();
+    }
+
+    void ResampleTileCache::SetBudget(size_t budgetInBytes)
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fBudgetInBytes = budgetInBytes;
+        EvictOverBudget();
+    }
+
+    void ResampleTileCache::Remove(const std::set<const void*>& sources)
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        for (auto it = fEntries.begin(); it != fEntries.end();)
+        {
+            if (sources.contains(it->key.source))
+            {
+                fSizeInBytes -= it->data->size();
+                fIndex.erase(it->key);
+                it = fEntries.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void ResampleTileCache::Clear()
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fEntries.clear();
+        fIndex.clear();
+        fSizeInBytes = 0;
+    }
+
+    ResampleTileCache::Statistics ResampleTileCache::GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        return { fHits, fMisses, fEvictions, fIndex.size(), fSizeInBytes, fBudgetInBytes };
+    }
+
+    void ResampleTileCache::EvictOverBudget()
+    {
+        while (fSizeInBytes > fBudgetInBytes && fEntries.empty() == false)
+        {
+            const Entry& leastRecent = fEntries.back();
+            fSizeInBytes -= leastRecent.data->size();
+            fIndex.erase(leastRecent.key);
+            fEntries.pop_back();
+            fEvictions++;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace OIV
+{
+    // Least recently used resampled tiles, held under a memory budget.
+    // A tile is identified by its source image, the size of the whole resampled image (the zoom level), the filter and its position.
+    class ResampleTileCache
+    {
+    public:
+        static constexpr uint32_t TileSize = 256;
+        static constexpr size_t DefaultBudgetInBytes = 256 * 1024 * 1024;
+
+        struct TileKey
+        {
+            const void* source;
+            uint32_t targetWidth;
+            uint32_t targetHeight;
+            uint32_t filter;
+            uint32_t tileX;
+            uint32_t tileY;
+
+            bool operator<(const TileKey& rhs) const
+            {
+                return std::tie(source, targetWidth, targetHeight, filter, tileX, tileY)
+                    < std::tie(rhs.source, rhs.targetWidth, rhs.targetHeight, rhs.filter, rhs.tileX, rhs.tileY);
+            }
+        };
+
+        using TileData = std::shared_ptr<const std::vector<std::byte>>;
+
+        struct Statistics
+        {
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t evictions;
+            size_t numTiles;
+            size_t sizeInBytes;
+            size_t budgetInBytes;
+        };
+
+        // Returns nullptr on a miss, 'source' is used to detect a new image allocated at the address of a released one.
+        TileData Find(const TileKey& key, const std::shared_ptr<const void>& source);
+        void Insert(const TileKey& key, const std::shared_ptr<const void>& source, TileData data);
+        void SetBudget(size_t budgetInBytes);
+        // Releases the tiles resampled from any of 'sources'.
+        void Remove(const std::set<const void*>& sources);
+        void Clear();
+        Statistics GetStatistics() const;
+
+    private: // methods
+        void EvictOverBudget();
+
+    private: // member fields
+        struct Entry
+        {
+            TileKey key;
+            std::weak_ptr<const void> source;
+            TileData data;
+        };
+
+        using EntryList = std::list<Entry>;
+        EntryList fEntries; // Most recently used first.
+        std::map<TileKey, EntryList::iterator> fIndex;
+        mutable std::mutex fMutex;
+        size_t fBudgetInBytes = DefaultBudgetInBytes;
+        size_t fSizeInBytes = 0;
+        uint64_t fHits = 0;
+        uint64_t fMisses = 0;
+        uint64_t fEvictions = 0;
+    };
+}
@@ -1,388 +1,801 @@
 #include "Resampler.h"
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+#include <ExoticNumbers/half.hpp>
 #include <LLUtils/PlatformUtility.h>
 #include <LLUtils/Exception.h>
 #include <System.h>
 
 namespace OIV
 {
-	void Resampler::Init()
+	// Source texels covered by the box of the target texel whose center is mapped to 'center'.
+	LLUTILS_FORCE_INLINE SourceSpan GetSourceSpan(size_t center, int32_t boxStart, int32_t boxEnd, size_t sourceSize)
 	{
-		//Lazy initialize.
-		if (fInitialized == false)
-		{
-			fNumOfIdealThreadsForResampling = System::GetIdealNumThreadsForMemoryOperations();
-			fTasks.resize(fNumOfIdealThreadsForResampling);
-			fThreads.resize(fNumOfIdealThreadsForResampling);
-			fInitialized = true;
-		}
+		// When magnifying the center of the last target texel may fall right after the last source texel.
+		const int64_t clampedCenter = static_cast<int64_t>(std::min(center, sourceSize - 1));
+		const int64_t start = clampedCenter + boxStart;
+		const int64_t end = clampedCenter + boxEnd;
+		return { static_cast<size_t>(std::clamp<int64_t>(start, 0, static_cast<int64_t>(sourceSize)))
+			, static_cast<size_t>(std::clamp<int64_t>(end, 0, static_cast<int64_t>(sourceSize))) };
 	}
 
-	void Resampler::Resample(const ResamplerParams& params)
+	// Position in source texels of the centers of the target texels along a single axis, in 32.32 fixed point.
+	// The center of target texel t is at (2t + 1) * sourceSize / (2 * targetSize), the position is the exact floor of it in fixed point,
+	// so centers falling on a texel boundary aren't rounded down to the previous texel.
+	// Moving to the next target texel adds a constant step and carries the remainder of the division instead of multiplying in double precision.
+	struct SourceStepper
 	{
-		Init();
-
-		const double ratiox = static_cast<double>(params.sourceWidth) / params.targetWidth;
-		const double ratioy = static_cast<double>(params.sourceHeight) / params.targetHeight;
-
-		const int32_t diffHor = static_cast<int32_t>(std::round(ratiox) / 2.0);
-		const int32_t diffVert = static_cast<int32_t>(std::round(ratioy) / 2.0);
-
-
-		ResamplerBox box{ -diffHor,-diffVert, diffHor,diffVert };
-
-		if (box.right == 0)
-			box.right = 1;
-		if (box.bottom == 0)
-			box.bottom = 1;
-
+		static constexpr int FractionBits = 32;
+		static constexpr int64_t One = int64_t{ 1 } << FractionBits;
+
+		uint64_t denominator;
+		uint64_t step;
+		uint64_t stepRemainder;
+		int64_t bias;
+		uint64_t position;
+		uint64_t remainder;
+
+		// 'bias' is added to every position: 0.5 rounds to the nearest texel, -0.5 gives the texel before the center, for interpolation.
+		SourceStepper(size_t sourceSize, size_t targetSize, double bias, size_t firstTarget)
+			: denominator(2 * static_cast<uint64_t>(targetSize))
+			, step((2 * static_cast<uint64_t>(sourceSize) << FractionBits) / denominator)
+			, stepRemainder((2 * static_cast<uint64_t>(sourceSize) << FractionBits) % denominator)
+			, bias(static_cast<int64_t>(bias * One))
+		{
+			// Split (2t + 1) * sourceSize * One / denominator so none of the products overflow.
+			const uint64_t numerator = (2 * static_cast<uint64_t>(firstTarget) + 1) * sourceSize;
+			const uint64_t fraction = (numerator % denominator) << FractionBits;
+			position = ((numerator / denominator) << FractionBits) + fraction / denominator;
+			remainder = fraction % denominator;
+		}
 
-		const int totalThreads = fNumOfIdealThreadsForResampling;
-		const size_t totalPixels = params.targetWidth * params.targetHeight;
-		//uint32_t resampledRowPitch = sourceImage->GetRowPitchInBytes();
-		//uint32_t pixelSize = sourceImage->GetBytesPerTexel();
+		int64_t Position() const { return static_cast<int64_t>(position) + bias; }
 
-		//uint32_t * sourceBuffer = const_cast<uint32_t*>(reinterpret_cast<const uint32_t*>(sourceImage->GetBufferAt(0, 0)));
-		//uint32_t * targetBuffer = const_cast<uint32_t*>(reinterpret_cast<const uint32_t*>(resampled->GetBufferAt(0, 0)));
+		void Next()
+		{
+			position += step;
+			remainder += stepRemainder;
+			if (remainder >= denominator)
+			{
+				remainder -= denominator;
+				position++;
+			}
+		}
 
-#if RESAMPLE_THREAD_POOL
-		static std::atomic_int count = 0;
-#endif
+		static int64_t Floor(int64_t position) { return position >> FractionBits; }
+		static float Fraction(int64_t position) { return static_cast<float>(position & (One - 1)) * (1.0f / One); }
+	};
 
-		ResampleTask templateTask;
-		templateTask.resampleParams = params;
-		templateTask.box = box;
-
-		templateTask.ratioX = ratiox;
-		templateTask.ratioY = ratioy;
-		templateTask.TaskID = 1000;
-		templateTask.totalThreads = totalThreads;
-		templateTask.totalTargetTexels = totalPixels;
-#if RESAMPLE_THREAD_POOL
-		static std::condition_variable allTasksDone;
-		static std::condition_variable cv;
-		static std::mutex mtx;
-		static std::mutex mtx1;
+	LLUTILS_FORCE_INLINE bool IsCancelled(const ResampleTask& task)
+	{
+		return task.resampleParams.cancellation != nullptr && task.resampleParams.cancellation->IsCancelled();
+	}
 
+	// Accumulator type and conversions for each channel type.
+	template <typename Channel>
+	struct ChannelTraits;
 
-		static std::function<void()> callback = []()
+	template <>
+	struct ChannelTraits<uint8_t>
+	{
+		using Accumulator = uint32_t;
+		static Accumulator Load(uint8_t value) { return value; }
+		static uint8_t Store(Accumulator sum, size_t count) { return static_cast<uint8_t>(sum / count); }
+		static float ToFloat(uint8_t value) { return value; }
+		static uint8_t FromFloat(float value) { return static_cast<uint8_t>(std::clamp(value + 0.5f, 0.0f, 255.0f)); }
+	};
+
+	template <>
+	struct ChannelTraits<uint16_t>
+	{
+		// A box of more than 65537 texels would overflow 32 bit.
+		using Accumulator = uint64_t;
+		static Accumulator Load(uint16_t value) { return value; }
+		static uint16_t Store(Accumulator sum, size_t count) { return static_cast<uint16_t>(sum / count); }
+		static float ToFloat(uint16_t value) { return value; }
+		static uint16_t FromFloat(float value) { return static_cast<uint16_t>(std::clamp(value + 0.5f, 0.0f, 65535.0f)); }
+	};
+
+	template <>
+	struct ChannelTraits<half_float::half>
+	{
+		using Accumulator = float;
+		static Accumulator Load(half_float::half value) { return static_cast<float>(value); }
+		static half_float::half Store(Accumulator sum, size_t count) { return half_float::half(sum / static_cast<float>(count)); }
+		static float ToFloat(half_float::half value) { return static_cast<float>(value); }
+		static half_float::half FromFloat(float value) { return half_float::half(value); }
+	};
+
+	template <>
+	struct ChannelTraits<float>
+	{
+		// Rows are added to and subtracted from the running sums, double keeps the round off error from building up.
+		using Accumulator = double;
+		static Accumulator Load(float value) { return value; }
+		static float Store(Accumulator sum, size_t count) { return static_cast<float>(sum / static_cast<double>(count)); }
+		static float ToFloat(float value) { return value; }
+		static float FromFloat(float value) { return value; }
+	};
+
+	// Two pass box average, produces the same result as ResampleBoxReference.
+	// 1. Horizontal pass - sum each source row over the box columns of every target texel,
+	//    each source row is read once and kept in a ring buffer while it's inside the box of the current target row.
+	// 2. Vertical pass - keep a running sum of the horizontal sums of the rows in the box,
+	//    moving to the next target row only adds the entering rows and subtracts the leaving rows.
+	template <typename Channel, size_t NumChannels>
+	size_t ResampleBoxSeparableImpl(const ResampleTask& task, size_t startY, size_t endY)
+	{
+		using Traits = ChannelTraits<Channel>;
+		using Accumulator = typename Traits::Accumulator;
+		constexpr bool IsRGBA8 = std::is_same_v<Channel, uint8_t> && NumChannels == 4;
+
+		const ResamplerParams& params = task.resampleParams;
+		const size_t sourceWidth = params.sourceWidth;
+		const size_t targetWidth = params.targetRegion.width;
+		const size_t targetRowElements = targetWidth * NumChannels;
+		const size_t sourceRowPitch = params.sourceRowPitchInBytes != 0 ? params.sourceRowPitchInBytes : sourceWidth * NumChannels * sizeof(Channel);
+		const uint8_t* sourceBuffer = reinterpret_cast<const uint8_t*>(params.sourceBuffer);
+		Channel* targetBuffer = reinterpret_cast<Channel*>(params.targetBuffer);
+
+		std::vector<SourceSpan> columnSpans(targetWidth);
+		SourceStepper columnStepper(sourceWidth, params.targetWidth, 0.5, params.targetRegion.x);
+		for (size_t targetX = 0; targetX < targetWidth; targetX++, columnStepper.Next())
+			columnSpans[targetX] = GetSourceSpan(static_cast<size_t>(SourceStepper::Floor(columnStepper.Position())), task.box.left, task.box.right, sourceWidth);
+
+		// A box never spans more rows than its height, the slot of a row is reused only after the row has left the box.
+		const size_t ringRows = static_cast<size_t>(task.box.bottom - task.box.top);
+		std::vector<Accumulator> rowSums(ringRows * targetRowElements);
+		std::vector<Accumulator> boxSums(targetRowElements);
+		SourceSpan window{};
+
+		const ResamplerKernels& kernels = ResamplerKernels::Get(params.simdLevel);
+		auto sumRow = [&](size_t sourceY)
 		{
-			if (++count == totalThreads)
+			Accumulator* sums = rowSums.data() + (sourceY % ringRows) * targetRowElements;
+			const uint8_t* sourceRow = sourceBuffer + sourceY * sourceRowPitch;
+			if constexpr (IsRGBA8)
 			{
-				allTasksDone.notify_one();
+				kernels.sumRowSpans(sourceRow, columnSpans.data(), targetWidth, sums);
 			}
-		};
-		templateTask.Callback = &callback;
-		templateTask.cv = &cv;
-		templateTask.mtx = &mtx;
+			else
+			{
+				const Channel* sourceTexels = reinterpret_cast<const Channel*>(sourceRow);
+				for (size_t targetX = 0; targetX < targetWidth; targetX++)
+				{
+					std::array<Accumulator, NumChannels> accum{};
+					for (size_t sourceX = columnSpans[targetX].start; sourceX < columnSpans[targetX].end; sourceX++)
+						for (size_t channel = 0; channel < NumChannels; channel++)
+							accum[channel] += Traits::Load(sourceTexels[sourceX * NumChannels + channel]);
 
+					std::copy(accum.begin(), accum.end(), sums + targetX * NumChannels);
+				}
+			}
+			return sums;
+		};
 
-		static std::vector<ResampleTask> tasks(totalThreads);
-#endif
+		SourceStepper rowStepper(params.sourceHeight, params.targetHeight, 0.5, startY);
+		for (size_t targetY = startY; targetY < endY; targetY++, rowStepper.Next())
+		{
+			if (IsCancelled(task))
+				return targetY - startY;
 
-#if 0
-		bool static created = false;
+			const SourceSpan rows = GetSourceSpan(static_cast<size_t>(SourceStepper::Floor(rowStepper.Position())), task.box.top, task.box.bottom, params.sourceHeight);
 
-		if (created == false)
-		{
-			for (int i = 0; i < totalThreads; i++)
+			if (rows.start < window.start || rows.start >= window.end || rows.end < window.end)
 			{
-				tasks[i] = templateTask;
-				threads[i] = std::thread(&ResampleUnit, &tasks[i]);
+				// No overlap with the box of the previous target row, start over.
+				std::fill(boxSums.begin(), boxSums.end(), Accumulator{});
+				window = { rows.start, rows.start };
+			}
 
+			for (size_t sourceY = window.start; sourceY < rows.start; sourceY++)
+			{
+				const Accumulator* sums = rowSums.data() + (sourceY % ringRows) * targetRowElements;
+				for (size_t i = 0; i < targetRowElements; i++)
+					boxSums[i] -= sums[i];
+			}
 
+			for (size_t sourceY = window.end; sourceY < rows.end; sourceY++)
+			{
+				const Accumulator* sums = sumRow(sourceY);
+				for (size_t i = 0; i < targetRowElements; i++)
+					boxSums[i] += sums[i];
 			}
 
-			while (count < totalThreads)
+			window = rows;
+
+			const size_t boxHeight = rows.end - rows.start;
+			Channel* targetRow = targetBuffer + (targetY - params.targetRegion.y) * targetRowElements;
+			for (size_t targetX = 0; targetX < targetWidth; targetX++)
 			{
-				Sleep(0);
+				const size_t totalPixels = (columnSpans[targetX].end - columnSpans[targetX].start) * boxHeight;
+				for (size_t channel = 0; channel < NumChannels; channel++)
+					targetRow[targetX * NumChannels + channel] = Traits::Store(boxSums[targetX * NumChannels + channel], totalPixels);
 			}
+		}
+		return endY - startY;
+	}
 
-			//std::unique_lock<std::mutex> lock(mtx1);
-			//allTasksDone.wait(lock);
+	// Separable polyphase filter, the weights of each target row and column are taken from precomputed tables.
+	// Each chunk of rows first filters horizontally the source rows it needs into a temporary buffer, then filters it vertically.
+	template <typename Channel, size_t NumChannels>
+	size_t ResamplePolyphaseImpl(const ResampleTask& task, size_t startY, size_t endY)
+	{
+		if (startY == endY)
+			return 0;
+
+		using Traits = ChannelTraits<Channel>;
+		const ResamplerParams& params = task.resampleParams;
+		const FilterWeights& horizontal = *task.horizontalWeights;
+		const FilterWeights& vertical = *task.verticalWeights;
+		const size_t targetWidth = params.targetRegion.width;
+		const size_t targetRowElements = targetWidth * NumChannels;
+		const size_t sourceRowPitch = params.sourceRowPitchInBytes != 0 ? params.sourceRowPitchInBytes : params.sourceWidth * NumChannels * sizeof(Channel);
+		const uint8_t* sourceBuffer = reinterpret_cast<const uint8_t*>(params.sourceBuffer);
+		Channel* targetBuffer = reinterpret_cast<Channel*>(params.targetBuffer);
+
+		// Window starts and ends are monotonic, so the first and last target rows bound the source rows of the chunk.
+		const size_t firstSourceRow = vertical.contributors[startY].start;
+		const size_t lastSourceRow = vertical.contributors[endY - 1].start + vertical.contributors[endY - 1].count;
+
+		std::vector<float> filteredRows((lastSourceRow - firstSourceRow) * targetRowElements);
+		for (size_t sourceY = firstSourceRow; sourceY < lastSourceRow; sourceY++)
+		{
+			if (IsCancelled(task))
+				return 0;
 
+			const Channel* sourceRow = reinterpret_cast<const Channel*>(sourceBuffer + sourceY * sourceRowPitch);
+			float* filteredRow = filteredRows.data() + (sourceY - firstSourceRow) * targetRowElements;
+			for (size_t targetX = 0; targetX < targetWidth; targetX++)
+			{
+				const FilterWeights::Contributors& contributors = horizontal.contributors[params.targetRegion.x + targetX];
+				const float* weights = horizontal.weights.data() + contributors.weightsOffset;
+				const Channel* texel = sourceRow + contributors.start * NumChannels;
+				std::array<float, NumChannels> accum{};
+				for (size_t i = 0; i < contributors.count; i++, texel += NumChannels)
+					for (size_t channel = 0; channel < NumChannels; channel++)
+						accum[channel] += weights[i] * Traits::ToFloat(texel[channel]);
+
+				std::copy(accum.begin(), accum.end(), filteredRow + targetX * NumChannels);
+			}
+		}
 
-			//while (count < totalThreads)
-			//{
-			//	Sleep(1);
-			//}
-			//All threads has been initialzied.
+		std::vector<float> accum(targetRowElements);
+		for (size_t targetY = startY; targetY < endY; targetY++)
+		{
+			if (IsCancelled(task))
+				return targetY - startY;
 
+			const FilterWeights::Contributors& contributors = vertical.contributors[targetY];
+			const float* weights = vertical.weights.data() + contributors.weightsOffset;
+			std::fill(accum.begin(), accum.end(), 0.0f);
+			for (size_t i = 0; i < contributors.count; i++)
+			{
+				const float* filteredRow = filteredRows.data() + (contributors.start + i - firstSourceRow) * targetRowElements;
+				const float weight = weights[i];
+				for (size_t element = 0; element < targetRowElements; element++)
+					accum[element] += weight * filteredRow[element];
+			}
 
-			created = true;
+			Channel* targetRow = targetBuffer + (targetY - params.targetRegion.y) * targetRowElements;
+			for (size_t element = 0; element < targetRowElements; element++)
+				targetRow[element] = Traits::FromFloat(accum[element]);
 		}
+		return endY - startY;
+	}
 
-		count = 0;
-		for (int i = 0; i < totalThreads; i++)
+	// Copy the source texel nearest to the center of each target texel, used for a quick preview.
+	template <typename Channel, size_t NumChannels>
+	size_t ResampleNearestImpl(const ResampleTask& task, size_t startY, size_t endY)
+	{
+		const ResamplerParams& params = task.resampleParams;
+		const size_t targetWidth = params.targetRegion.width;
+		const size_t sourceRowPitch = params.sourceRowPitchInBytes != 0 ? params.sourceRowPitchInBytes : params.sourceWidth * NumChannels * sizeof(Channel);
+		const uint8_t* sourceBuffer = reinterpret_cast<const uint8_t*>(params.sourceBuffer);
+		Channel* targetBuffer = reinterpret_cast<Channel*>(params.targetBuffer);
+
+		std::vector<size_t> sourceColumns(targetWidth);
+		SourceStepper columnStepper(params.sourceWidth, params.targetWidth, 0.0, params.targetRegion.x);
+		for (size_t targetX = 0; targetX < targetWidth; targetX++, columnStepper.Next())
+			sourceColumns[targetX] = std::min(static_cast<size_t>(SourceStepper::Floor(columnStepper.Position())), static_cast<size_t>(params.sourceWidth) - 1);
+
+		SourceStepper rowStepper(params.sourceHeight, params.targetHeight, 0.0, startY);
+		for (size_t targetY = startY; targetY < endY; targetY++, rowStepper.Next())
 		{
-			tasks[i] = templateTask;
-			tasks[i].TaskID = i;
+			if (IsCancelled(task))
+				return targetY - startY;
+
+			const size_t sourceY = std::min(static_cast<size_t>(SourceStepper::Floor(rowStepper.Position())), static_cast<size_t>(params.sourceHeight) - 1);
+			const Channel* sourceRow = reinterpret_cast<const Channel*>(sourceBuffer + sourceY * sourceRowPitch);
+			Channel* targetRow = targetBuffer + (targetY - params.targetRegion.y) * targetWidth * NumChannels;
+			for (size_t targetX = 0; targetX < targetWidth; targetX++)
+				std::copy_n(sourceRow + sourceColumns[targetX] * NumChannels, NumChannels, targetRow + targetX * NumChannels);
 		}
+		return endY - startY;
+	}
 
-		cv.notify_all();
-
-		std::unique_lock<std::mutex> lock(mtx1);
-		allTasksDone.wait(lock);
-
-		//cv.notify_all();
-#endif
+	// Source texels contributing to a target texel when interpolating, 'first' may lie outside the image and is clamped on use.
+	template <size_t Taps>
+	struct InterpolationTaps
+	{
+		int64_t first;
+		std::array<float, Taps> weights;
+	};
 
-		for (int i = 0; i < totalThreads; i++)
+	// 'position' is biased by -0.5, so its integer part is the source texel before the target texel center.
+	template <size_t Taps>
+	LLUTILS_FORCE_INLINE InterpolationTaps<Taps> GetInterpolationTaps(int64_t position)
+	{
+		const int64_t before = SourceStepper::Floor(position);
+		const float t = SourceStepper::Fraction(position);
+		if constexpr (Taps == 2)
+		{
+			return { before, { 1.0f - t, t } };
+		}
+		else
 		{
-			fTasks[i] = templateTask;;
-			fTasks[i].TaskID = i;
-			fThreads[i] = std::thread(std::bind(&Resampler::ResampleThreadEntryPoint, this, std::placeholders::_1), &fTasks[i]);
+			static_assert(Taps == 4, "Bicubic interpolation uses 4 taps");
+			// Catmull-Rom spline, passes through the source texels.
+			const float t2 = t * t;
+			const float t3 = t2 * t;
+			return { before - 1, { 0.5f * (-t3 + 2.0f * t2 - t), 0.5f * (3.0f * t3 - 5.0f * t2 + 2.0f), 0.5f * (-3.0f * t3 + 4.0f * t2 + t), 0.5f * (t3 - t2) } };
 		}
+	}
 
-		for (int i = 0; i < totalThreads; i++)
-			fThreads[i].join();
+	// Bilinear (2 taps) and bicubic (4 taps) interpolation for magnification, source texels outside the image are clamped to its edges.
+	// Each source row is filtered horizontally once into a ring of 'Taps' rows and kept for all the target rows that use it.
+	template <typename Channel, size_t NumChannels, size_t Taps>
+	size_t ResampleInterpolatedImpl(const ResampleTask& task, size_t startY, size_t endY)
+	{
+		using Traits = ChannelTraits<Channel>;
+		const ResamplerParams& params = task.resampleParams;
+		const size_t targetWidth = params.targetRegion.width;
+		const size_t targetRowElements = targetWidth * NumChannels;
+		const size_t sourceRowPitch = params.sourceRowPitchInBytes != 0 ? params.sourceRowPitchInBytes : params.sourceWidth * NumChannels * sizeof(Channel);
+		const uint8_t* sourceBuffer = reinterpret_cast<const uint8_t*>(params.sourceBuffer);
+		Channel* targetBuffer = reinterpret_cast<Channel*>(params.targetBuffer);
+		const int64_t lastColumn = static_cast<int64_t>(params.sourceWidth) - 1;
+		const int64_t lastRow = static_cast<int64_t>(params.sourceHeight) - 1;
+
+		std::vector<size_t> columns(targetWidth * Taps);
+		std::vector<float> columnWeights(targetWidth * Taps);
+		SourceStepper columnStepper(params.sourceWidth, params.targetWidth, -0.5, params.targetRegion.x);
+		for (size_t targetX = 0; targetX < targetWidth; targetX++, columnStepper.Next())
+		{
+			const InterpolationTaps<Taps> taps = GetInterpolationTaps<Taps>(columnStepper.Position());
+			for (size_t i = 0; i < Taps; i++)
+			{
+				columns[targetX * Taps + i] = static_cast<size_t>(std::clamp<int64_t>(taps.first + static_cast<int64_t>(i), 0, lastColumn));
+				columnWeights[targetX * Taps + i] = taps.weights[i];
+			}
+		}
 
-#if 0
-		for (int i = 0; i < totalThreads; i++)
+		// The rows of a single target row are consecutive, so each of them has its own slot in the ring.
+		std::vector<float> filteredRows(Taps * targetRowElements);
+		std::array<int64_t, Taps> slotRows;
+		slotRows.fill(-1);
+		auto filterRow = [&](int64_t sourceY) -> const float*
 		{
-			int threadnumber = i;
-			threads[i] = std::thread([&, threadnumber]
+			const size_t slot = static_cast<size_t>(sourceY) % Taps;
+			float* filteredRow = filteredRows.data() + slot * targetRowElements;
+			if (slotRows[slot] == sourceY)
+				return filteredRow;
+
+			slotRows[slot] = sourceY;
+			const Channel* sourceRow = reinterpret_cast<const Channel*>(sourceBuffer + static_cast<size_t>(sourceY) * sourceRowPitch);
+			for (size_t targetX = 0; targetX < targetWidth; targetX++)
+			{
+				std::array<float, NumChannels> accum{};
+				for (size_t i = 0; i < Taps; i++)
 				{
-					uint32_t currentTargetPixel = threadnumber;
-
-					AverageParams params1;
-					params1.horSpan = diffHor;
-					params1.vertSpan = diffVert;
-					params1.imageBuffer = sourceBuffer;
-					params1.ImageHeight = sourceImage->GetHeight();
-					params1.ImageWidth = sourceImage->GetWidth();
-
-					while (currentTargetPixel < totalPixels)
-					{
-						const uint32_t targetY = currentTargetPixel / width;
-						const uint32_t targetX = currentTargetPixel % width;
-
-						params1.ImageX = static_cast<uint32_t>((targetX + 0.5) * ratiox);
-						params1.ImageY = static_cast<uint32_t>((targetY + 0.5) * ratioy);
-
-						targetBuffer[currentTargetPixel] = GetAverageAt(params1);
-						currentTargetPixel += totalThreads;
-					}
+					const Channel* texel = sourceRow + columns[targetX * Taps + i] * NumChannels;
+					const float weight = columnWeights[targetX * Taps + i];
+					for (size_t channel = 0; channel < NumChannels; channel++)
+						accum[channel] += weight * Traits::ToFloat(texel[channel]);
 				}
-			).detach();
+				std::copy(accum.begin(), accum.end(), filteredRow + targetX * NumChannels);
+			}
+			return filteredRow;
+		};
+
+		SourceStepper rowStepper(params.sourceHeight, params.targetHeight, -0.5, startY);
+		for (size_t targetY = startY; targetY < endY; targetY++, rowStepper.Next())
+		{
+			if (IsCancelled(task))
+				return targetY - startY;
+
+			const InterpolationTaps<Taps> taps = GetInterpolationTaps<Taps>(rowStepper.Position());
+			std::array<const float*, Taps> rows;
+			for (size_t i = 0; i < Taps; i++)
+				rows[i] = filterRow(std::clamp<int64_t>(taps.first + static_cast<int64_t>(i), 0, lastRow));
+
+			Channel* targetRow = targetBuffer + (targetY - params.targetRegion.y) * targetRowElements;
+			for (size_t element = 0; element < targetRowElements; element++)
+			{
+				float sum = 0.0f;
+				for (size_t i = 0; i < Taps; i++)
+					sum += taps.weights[i] * rows[i][element];
+				targetRow[element] = Traits::FromFloat(sum);
+			}
 		}
-#endif
+		return endY - startY;
 	}
 
+	template <typename Channel, typename Func>
+	void DispatchNumChannels(uint8_t numChannels, Func&& func)
+	{
+		switch (numChannels)
+		{
+		case 1:
+			func(Channel{}, std::integral_constant<size_t, 1>{});
+			break;
+		case 2:
+			func(Channel{}, std::integral_constant<size_t, 2>{});
+			break;
+		case 3:
+			func(Channel{}, std::integral_constant<size_t, 3>{});
+			break;
+		case 4:
+			func(Channel{}, std::integral_constant<size_t, 4>{});
+			break;
+		default:
+			LL_EXCEPTION_UNEXPECTED_VALUE;
+		}
+	}
 
-	LLUTILS_FORCE_INLINE uint32_t  Resampler::GetAverageAt(const AverageParams& params)
+	// Invoke func(Channel, NumChannels) with the channel type and the number of channels of the params as compile time values.
+	template <typename Func>
+	void DispatchTexelLayout(const ResamplerParams& params, Func&& func)
 	{
-#pragma pack(push,1)
-		struct Color
+		switch (params.channelType)
 		{
-			uint8_t b;
-			uint8_t g;
-			uint8_t r;
-			uint8_t a;
-		};
+		case ResampleChannelType::UInt8:
+			DispatchNumChannels<uint8_t>(params.numChannels, func);
+			break;
+		case ResampleChannelType::UInt16:
+			DispatchNumChannels<uint16_t>(params.numChannels, func);
+			break;
+		case ResampleChannelType::Float16:
+			DispatchNumChannels<half_float::half>(params.numChannels, func);
+			break;
+		case ResampleChannelType::Float32:
+			DispatchNumChannels<float>(params.numChannels, func);
+			break;
+		default:
+			LL_EXCEPTION_UNEXPECTED_VALUE;
+		}
+	}
 
+	Resampler::Resampler(uint32_t numThreads) : fRequestedNumThreads(numThreads)
+	{
 
-		struct Color16
-		{
-			uint16_t b;
-			uint16_t g;
-			uint16_t r;
-			uint16_t a;
-		};
+	}
 
-		struct Color32
+	bool Resampler::IsSupported(ResampleChannelType channelType, uint8_t numChannels)
+	{
+		switch (channelType)
 		{
-			uint32_t b;
-			uint32_t g;
-			uint32_t r;
-			uint32_t a;
-		};
-
+		case ResampleChannelType::UInt8:
+		case ResampleChannelType::UInt16:
+		case ResampleChannelType::Float16:
+		case ResampleChannelType::Float32:
+			return numChannels >= 1 && numChannels <= 4;
+		default:
+			return false;
+		}
+	}
 
-		alignas(16) Color32 accum {};
+	void Resampler::Init()
+	{
+		//Lazy initialize, resampling may be requested from several threads.
+		std::call_once(fInitOnce, [this]
+			{
+				fNumOfIdealThreadsForResampling = fRequestedNumThreads != 0 ? fRequestedNumThreads : System::GetIdealNumThreadsForMemoryOperations();
+				// The calling thread takes part in resampling, so one worker less is needed.
+				fThreadPool = std::make_unique<ThreadPool>(std::max(fNumOfIdealThreadsForResampling, 1u) - 1);
+			});
+	}
 
+	bool Resampler::Resample(const ResamplerParams& params)
+	{
+		if (IsSupported(params.channelType, params.numChannels) == false)
+			LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Unsupported texel layout");
 
+		if (params.filter == ResampleFilter::BoxReference && (params.channelType != ResampleChannelType::UInt8 || params.numChannels != 4))
+			LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Reference box filter supports 8 bit RGBA only");
 
-		//alignas(16) thread_local static Color RGBA_PAIR[8192];
+		Init();
 
-		//alignas(16)  Color16 accumColor[2]{};
+		const double ratiox = static_cast<double>(params.sourceWidth) / params.targetWidth;
+		const double ratioy = static_cast<double>(params.sourceHeight) / params.targetHeight;
 
-		const size_t sourceYStart = std::max<size_t>(0, params.box.top + params.ImageY);
-		const size_t sourceYEnd = std::min<size_t>(params.ImageHeight, params.ImageY + params.box.bottom);
-		const size_t sourcexStart = std::max<size_t>(0, params.box.left + params.ImageX);
-		const size_t sourceXEnd = std::min<size_t>(params.ImageWidth, params.ImageX + params.box.right);
+		const int32_t diffHor = static_cast<int32_t>(std::round(ratiox) / 2.0);
+		const int32_t diffVert = static_cast<int32_t>(std::round(ratioy) / 2.0);
 
 
-		
-		const size_t totalPixels = (sourceXEnd - sourcexStart) * (sourceYEnd - sourceYStart);
+		ResamplerBox box{ -diffVert, -diffHor, diffVert, diffHor };
 
+		if (box.right == 0)
+			box.right = 1;
+		if (box.bottom == 0)
+			box.bottom = 1;
 
-#pragma pack(pop,1)
-#if 0
 
-		//method 1
-		int currentPixel = 0;
-		while (currentPixel < totalPixels)
-		{
+		const size_t totalThreads = fNumOfIdealThreadsForResampling;
+		ResampleTask templateTask;
+		templateTask.resampleParams = params;
+		ResamplerRegion& region = templateTask.resampleParams.targetRegion;
+		if (region.width == 0 || region.height == 0)
+			region = { 0, 0, params.targetWidth, params.targetHeight };
+		else if (region.x + region.width > params.targetWidth || region.y + region.height > params.targetHeight)
+			LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Target region exceeds the target image");
 
-			const uint32_t sourceY = currentPixel / horSpan;
-			const uint32_t sourceX = currentPixel % horSpan;
+		const size_t totalPixels = static_cast<size_t>(region.width) * region.height;
 
-			const IMUtil::PixelUtil::BitTexel32Ex c = *reinterpret_cast<const IMUtil::PixelUtil::BitTexel32Ex*>
-				(params.imageBuffer + (sourceX + sourcexStart) + (sourceY + sourceYStart) * params.ImageWidth);
-			//accum.A += c.W;
-			accum.R += c.Z;
-			accum.G += c.Y;
-			accum.B += c.X;
+		templateTask.box = box;
 
-			currentPixel++;
+		templateTask.totalTargetTexels = totalPixels;
+		templateTask.horizontalWeights = nullptr;
+		templateTask.verticalWeights = nullptr;
+
+		std::shared_ptr<const FilterWeights> horizontalWeights;
+		std::shared_ptr<const FilterWeights> verticalWeights;
+		// Interpolation alone would skip source texels when reducing, so a reducing interpolation filter stretches its kernel as the polyphase filters do.
+		const bool isInterpolation = params.filter == ResampleFilter::Bilinear || params.filter == ResampleFilter::Bicubic;
+		const bool isPolyphase = params.filter == ResampleFilter::Lanczos3 || params.filter == ResampleFilter::Mitchell || params.filter == ResampleFilter::CatmullRom
+			|| (isInterpolation && (ratiox > 1.0 || ratioy > 1.0));
+		if (isPolyphase)
+		{
+			horizontalWeights = GetFilterWeights(params.filter, params.sourceWidth, params.targetWidth);
+			verticalWeights = GetFilterWeights(params.filter, params.sourceHeight, params.targetHeight);
+			templateTask.horizontalWeights = horizontalWeights.get();
+			templateTask.verticalWeights = verticalWeights.get();
 		}
 
-#elif 0
-		//method 2
-		int sourceX = sourcexStart;
-		int sourceY = sourceYStart;
-		while (sourceX < sourceXEnd)
+		if (params.cancellation != nullptr && params.cancellation->IsCancelled())
 		{
-			const IMUtil::PixelUtil::BitTexel32Ex c = *reinterpret_cast<const IMUtil::PixelUtil::BitTexel32Ex*>
-				(params.imageBuffer + sourceX + sourceY * params.ImageWidth);
-			//accum.A += c.W;
-			accum.R += c.Z;
-			accum.G += c.Y;
-			accum.B += c.X;
-
-			if (++sourceX == sourceXEnd)
-			{
-				sourceX = sourcexStart;
-				if (++sourceY == sourceYEnd)
-					break;
-			}
+			fCancelledJobs++;
+			fSkippedRows += region.height;
+			return false;
 		}
 
-#elif 1
-		//method 3
-
-		//_mm256_lo
-		//__m256i v1(;
-		//__m256i v2(= 12;
-		//__m256i v3 = _mm256_add_epi16(v1, v2);
-
-
-		for (size_t sourceY = sourceYStart; sourceY < sourceYEnd; sourceY++)
-			for (size_t sourceX = sourcexStart; sourceX < sourceXEnd; sourceX++)
+		// Threads take chunks of rows until all rows are handed out, returns when all chunks are done.
+		// Each chunk checks for cancellation before every row it produces, a cancelled job skips all remaining chunks.
+		const size_t totalRows = region.height;
+		const size_t rowsPerChunk = GetRowsPerChunk(totalRows, totalThreads);
+		std::atomic_size_t nextRow = 0;
+		std::atomic_size_t skippedRows = 0;
+		std::vector<uint64_t> threadBusyTimeNs(totalThreads);
+		fThreadPool->ParallelFor(totalThreads, [this, &templateTask, &nextRow, &skippedRows, &threadBusyTimeNs, totalRows, rowsPerChunk](size_t taskIndex)
 			{
-				//RGBA_PAIR [i++] = *reinterpret_cast<const Color*>(params.imageBuffer + sourceX + sourceY * params.ImageWidth);
+				const auto start = std::chrono::steady_clock::now();
+				size_t skipped = 0;
+				for (size_t chunkStart = nextRow.fetch_add(rowsPerChunk, std::memory_order_relaxed); chunkStart < totalRows
+					; chunkStart = nextRow.fetch_add(rowsPerChunk, std::memory_order_relaxed))
+				{
+					const size_t startY = templateTask.resampleParams.targetRegion.y + chunkStart;
+					skipped += ResampleRows(templateTask, startY, startY + std::min(rowsPerChunk, totalRows - chunkStart));
+				}
 
-				alignas(16) const Color* c = reinterpret_cast<const Color*>(params.imageBuffer + sourceX + sourceY * params.ImageWidth);
-				accum.b += c->b;
-				accum.g += c->g;
-				accum.r += c->r;
-				accum.a += c->a;
-			}
+				threadBusyTimeNs[taskIndex] = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+				skippedRows += skipped;
+			});
 
+		fJobs++;
+		fChunks += (totalRows + rowsPerChunk - 1) / rowsPerChunk;
+		fThreads += totalThreads;
+		fBusyTimeNs += std::accumulate(threadBusyTimeNs.begin(), threadBusyTimeNs.end(), uint64_t{ 0 });
+		fMaxThreadBusyTimeNs += *std::max_element(threadBusyTimeNs.begin(), threadBusyTimeNs.end());
 
-		alignas(16) Color c {
-			static_cast<uint8_t>(accum.b / totalPixels)
-				, static_cast<uint8_t>   (accum.g / totalPixels)
-				, static_cast<uint8_t>   (accum.r / totalPixels)
-				, static_cast<uint8_t>   (accum.a / totalPixels)
-		};
+		if (skippedRows > 0)
+		{
+			fCancelledJobs++;
+			fSkippedRows += skippedRows;
+			return false;
+		}
+		return true;
+	}
 
+	ResamplerStatistics Resampler::GetStatistics() const
+	{
+		return { fCancelledJobs.load(), fSkippedRows.load(), fJobs.load(), fChunks.load(), fBusyTimeNs.load(), fMaxThreadBusyTimeNs.load(), fThreads.load() };
+	}
 
 
-		/*Color c{ static_cast<uint8_t>((accumColor[0].b + accumColor[1].b) / totalPixels)
-			, static_cast<uint8_t>   ((accumColor[0].g + accumColor[1].g) / totalPixels)
-			, static_cast<uint8_t>   ((accumColor[0].r + accumColor[1].r) / totalPixels)
-			, static_cast<uint8_t>   ((accumColor[0].a + accumColor[1].a) / totalPixels)
-		};*/
+	LLUTILS_FORCE_INLINE uint32_t  Resampler::GetAverageAt(const AverageParams& params)
+	{
+#pragma pack(push,1)
+		struct Color
+		{
+			uint8_t b;
+			uint8_t g;
+			uint8_t r;
+			uint8_t a;
+		};
+#pragma pack(pop)
 
+		struct Color32
+		{
+			uint32_t b;
+			uint32_t g;
+			uint32_t r;
+			uint32_t a;
+		};
 
-#elif 0
-		//box 3x3
-		//method 3
-		const size_t two = 1;
-		const uint32_t* bufferStart = params.imageBuffer + sourcexStart + sourceYStart * params.ImageWidth;
-		const Color* c0 = reinterpret_cast<const Color*>(bufferStart + 0 + 0 * params.ImageWidth);
+		Color32 accum {};
 
-		const Color* c1 = reinterpret_cast<const Color*>(bufferStart + 1 + 0 * params.ImageWidth);
-		const Color* c2 = reinterpret_cast<const Color*>(bufferStart + two + 0 * params.ImageWidth);
-		const Color* c3 = reinterpret_cast<const Color*>(bufferStart + 0 + 1 * params.ImageWidth);
-		const Color* c4 = reinterpret_cast<const Color*>(bufferStart + 1 + 1 * params.ImageWidth);
-		const Color* c5 = reinterpret_cast<const Color*>(bufferStart + two + 1 * params.ImageWidth);
-		const Color* c6 = reinterpret_cast<const Color*>(bufferStart + 0 + two * params.ImageWidth);
-		const Color* c7 = reinterpret_cast<const Color*>(bufferStart + 1 + two * params.ImageWidth);
-		const Color* c8 = reinterpret_cast<const Color*>(bufferStart + two + two * params.ImageWidth);
+		const SourceSpan rows = GetSourceSpan(params.ImageY, params.box.top, params.box.bottom, params.ImageHeight);
+		const SourceSpan columns = GetSourceSpan(params.ImageX, params.box.left, params.box.right, params.ImageWidth);
+		const size_t totalPixels = (columns.end - columns.start) * (rows.end - rows.start);
 
-		/*accum.A = (c0->a  + c1->a + c2>-a + c3->a + c4->a + c5->a + c6->a + c7->a + c8->a) /;
-		accum.R = c0->r;
-		accum.G = c0->g;
-		accum.B = c0->b;*/
+		for (size_t sourceY = rows.start; sourceY < rows.end; sourceY++)
+			for (size_t sourceX = columns.start; sourceX < columns.end; sourceX++)
+			{
+				const Color* c = reinterpret_cast<const Color*>(params.imageBuffer + sourceX + sourceY * params.ImageRowPitch);
+				accum.b += c->b;
+				accum.g += c->g;
+				accum.r += c->r;
+				accum.a += c->a;
+			}
 
-		Color c{ static_cast<uint8_t>((static_cast<size_t>(c0->b) + c1->b + c2->b + c3->b + c4->b + c5->b + c6->b + c7->b + c8->b) / totalPixels)
-			, static_cast<uint8_t>((static_cast<size_t>(c0->g) + c1->g + c2->g + c3->g + c4->g + c5->g + c6->g + c7->g + c8->g) / totalPixels)
-			, static_cast<uint8_t>((static_cast<size_t>(c0->r) + c1->r + c2->r + c3->r + c4->r + c5->r + c6->r + c7->r + c8->r) / totalPixels)
-			, static_cast<uint8_t>((static_cast<size_t>(c0->a) + c1->a + c2->a + c3->a + c4->a + c5->a + c6->a + c7->a + c8->a) / totalPixels)
+		const Color c {
+			  static_cast<uint8_t>(accum.b / totalPixels)
+			, static_cast<uint8_t>(accum.g / totalPixels)
+			, static_cast<uint8_t>(accum.r / totalPixels)
+			, static_cast<uint8_t>(accum.a / totalPixels)
 		};
 
-#endif
+		return *reinterpret_cast<const uint32_t*>(&c);
+	}
 
-		return *reinterpret_cast<uint32_t*>(&c);
+	size_t Resampler::GetRowsPerChunk(size_t totalRows, size_t numThreads)
+	{
+		const size_t numChunks = numThreads * ChunksPerThread;
+		return std::max((totalRows + numChunks - 1) / numChunks, MinRowsPerChunk);
 	}
 
-	void  Resampler::ResampleThreadEntryPoint(ResampleTask* task)
+	size_t Resampler::ResampleRows(const ResampleTask& task, size_t startY, size_t endY)
 	{
-#if RESAMPLE_THREAD_POOL
-		//while (true)
+		size_t completedRows;
+		switch (task.resampleParams.filter)
 		{
-			//if (task->TaskID < 100)
-			{
-#endif
-				const size_t targetWidth = task->resampleParams.targetWidth;
-				const size_t targetHeight = task->resampleParams.targetHeight;
-				const double ratiox = task->ratioX;
-				const double ratioy = task->ratioY;
-				const uint32_t* sourceBuffer = task->resampleParams.sourceBuffer;
-				const size_t totalThreads = task->totalThreads;
-				const size_t sourceWidth = task->resampleParams.sourceWidth;
-				const size_t sourceHeight = task->resampleParams.sourceHeight;
-
-
-				uint32_t* targetBuffer = task->resampleParams.targetBuffer;
+		case ResampleFilter::Box:
+			completedRows = ResampleBoxSeparable(task, startY, endY);
+			break;
+		case ResampleFilter::BoxReference:
+			completedRows = ResampleBoxReference(task, startY, endY);
+			break;
+		case ResampleFilter::Lanczos3:
+		case ResampleFilter::Mitchell:
+		case ResampleFilter::CatmullRom:
+			completedRows = ResamplePolyphase(task, startY, endY);
+			break;
+		case ResampleFilter::Nearest:
+			completedRows = ResampleNearest(task, startY, endY);
+			break;
+		case ResampleFilter::Bilinear:
+		case ResampleFilter::Bicubic:
+			// Filter weights are set when reducing.
+			completedRows = task.horizontalWeights != nullptr ? ResamplePolyphase(task, startY, endY) : ResampleInterpolated(task, startY, endY);
+			break;
+		default:
+			LL_EXCEPTION_UNEXPECTED_VALUE;
+		}
+		return (endY - startY) - completedRows;
+	}
 
-				AverageParams params1;
-				params1.imageBuffer = sourceBuffer;
-				params1.ImageHeight = sourceHeight;
-				params1.ImageWidth = sourceWidth;
-				params1.box = task->box;
+	size_t Resampler::ResampleBoxReference(const ResampleTask& task, size_t startY, size_t endY)
+	{
+		const ResamplerRegion& region = task.resampleParams.targetRegion;
+		uint32_t* targetBuffer = reinterpret_cast<uint32_t*>(task.resampleParams.targetBuffer);
+
+		AverageParams params1;
+		params1.imageBuffer = reinterpret_cast<const uint32_t*>(task.resampleParams.sourceBuffer);
+		params1.ImageHeight = task.resampleParams.sourceHeight;
+		params1.ImageWidth = task.resampleParams.sourceWidth;
+		params1.ImageRowPitch = task.resampleParams.sourceRowPitchInBytes != 0 ? task.resampleParams.sourceRowPitchInBytes / sizeof(uint32_t) : params1.ImageWidth;
+		params1.box = task.box;
+
+		const SourceStepper firstColumnStepper(params1.ImageWidth, task.resampleParams.targetWidth, 0.5, region.x);
+		SourceStepper rowStepper(params1.ImageHeight, task.resampleParams.targetHeight, 0.5, startY);
+		for (size_t targetY = startY; targetY < endY; targetY++, rowStepper.Next())
+		{
+			if (IsCancelled(task))
+				return targetY - startY;
 
-				const size_t startY = task->TaskID * (targetHeight / totalThreads);
-				const size_t endY = task->TaskID == totalThreads - 1 ? targetHeight : (task->TaskID + 1) * (targetHeight / totalThreads);
+			params1.ImageY = static_cast<size_t>(SourceStepper::Floor(rowStepper.Position()));
+			SourceStepper columnStepper = firstColumnStepper;
+			for (size_t targetX = region.x; targetX < region.x + region.width; targetX++, columnStepper.Next())
+			{
+				params1.ImageX = static_cast<size_t>(SourceStepper::Floor(columnStepper.Position()));
+				targetBuffer[(targetY - region.y) * region.width + targetX - region.x] = GetAverageAt(params1);
+			}
+		}
+		return endY - startY;
+	}
 
+	size_t Resampler::ResampleBoxSeparable(const ResampleTask& task, size_t startY, size_t endY)
+	{
+		size_t completedRows = 0;
+		DispatchTexelLayout(task.resampleParams, [&](auto channel, auto numChannels)
+			{
+				completedRows = ResampleBoxSeparableImpl<decltype(channel), decltype(numChannels)::value>(task, startY, endY);
+			});
+		return completedRows;
+	}
 
-				for (size_t targetY = startY; targetY < endY; targetY++)
-					for (size_t targetX = 0; targetX < targetWidth; targetX++)
-						//while (currentTargetPixel < totalTargetTexels)
-					{
-						//				const size_t targetY = currentTargetPixel / targetWidth;
-										//const size_t targetX = currentTargetPixel - targetY * targetWidth;
+	size_t Resampler::ResamplePolyphase(const ResampleTask& task, size_t startY, size_t endY)
+	{
+		size_t completedRows = 0;
+		DispatchTexelLayout(task.resampleParams, [&](auto channel, auto numChannels)
+			{
+				completedRows = ResamplePolyphaseImpl<decltype(channel), decltype(numChannels)::value>(task, startY, endY);
+			});
+		return completedRows;
+	}
 
-						params1.ImageX = static_cast<size_t>((targetX + 0.5) * ratiox + 0.5); // adding 0.5 before casting instead of rounding
-						params1.ImageY = static_cast<size_t>((targetY + 0.5) * ratioy + 0.5); // much faster solution.
+	size_t Resampler::ResampleNearest(const ResampleTask& task, size_t startY, size_t endY)
+	{
+		size_t completedRows = 0;
+		DispatchTexelLayout(task.resampleParams, [&](auto channel, auto numChannels)
+			{
+				completedRows = ResampleNearestImpl<decltype(channel), decltype(numChannels)::value>(task, startY, endY);
+			});
+		return completedRows;
+	}
 
-						targetBuffer[targetY * targetWidth + targetX] = GetAverageAt(params1);
-						//targetBuffer[currentTargetPixel] = GetAverageAt(params1);
-						//currentTargetPixel += totalThreads;
-					}
+	size_t Resampler::ResampleInterpolated(const ResampleTask& task, size_t startY, size_t endY)
+	{
+		size_t completedRows = 0;
+		DispatchTexelLayout(task.resampleParams, [&](auto channel, auto numChannels)
+			{
+				if (task.resampleParams.filter == ResampleFilter::Bilinear)
+					completedRows = ResampleInterpolatedImpl<decltype(channel), decltype(numChannels)::value, 2>(task, startY, endY);
+				else
+					completedRows = ResampleInterpolatedImpl<decltype(channel), decltype(numChannels)::value, 4>(task, startY, endY);
+			});
+		return completedRows;
+	}
 
-#if RESAMPLE_THREAD_POOL
-			}
+	std::shared_ptr<const FilterWeights> Resampler::GetFilterWeights(ResampleFilter filter, size_t sourceSize, size_t targetSize)
+	{
+		std::lock_guard<std::mutex> lock(fFilterWeightsMutex);
+		const FilterWeightsKey key{ filter, sourceSize, targetSize };
+		auto it = fFilterWeights.find(key);
+		if (it != fFilterWeights.end())
+			return it->second;
+
+		const FilterKernel* kernel;
+		switch (filter)
+		{
+		case ResampleFilter::Lanczos3:
+			kernel = &FilterKernel::Lanczos3;
+			break;
+		case ResampleFilter::Mitchell:
+			kernel = &FilterKernel::Mitchell;
+			break;
+		case ResampleFilter::CatmullRom:
+		case ResampleFilter::Bicubic:
+			kernel = &FilterKernel::CatmullRom;
+			break;
+		case ResampleFilter::Bilinear:
+			kernel = &FilterKernel::Triangle;
+			break;
+		default:
+			LL_EXCEPTION_UNEXPECTED_VALUE;
+		}
 
-			(*task->Callback)();
-			std::unique_lock<std::mutex> lock(*task->mtx);
-			task->cv->wait(lock);
+		// Zooming creates a new size pair for every zoom level, keep only the recent ones.
+		if (fFilterWeights.size() >= MaxCachedFilterWeights)
+			fFilterWeights.clear();
 
-		}
-#endif
+		auto weights = std::make_shared<const FilterWeights>(FilterWeights::Create(*kernel, sourceSize, targetSize));
+		fFilterWeights.emplace(key, weights);
+		return weights;
 	}
-}
\ No newline at end of file
+}
@@ -1,11 +1,13 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
-#include <vector>
-#include <thread>
-namespace std
-{
-	class thread;
-}
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include "ThreadPool.h"
+#include "ResamplerKernels.h"
+#include "ResamplerWeights.h"
 
 
 namespace OIV
@@ -19,14 +21,74 @@ namespace OIV
 		int32_t right;
 	};
 
+	enum class ResampleFilter
+	{
+		  Box			// Box average computed with separable running sums, cost per source texel is independent of the ratio.
+		, BoxReference	// Box average computed seperately for each target texel, 8 bit RGBA only.
+		, Lanczos3		// Separable polyphase filters, weights are precomputed per source and target size.
+		, Mitchell
+		, CatmullRom
+		, Nearest		// Nearest source texel, no filtering, for a quick preview.
+		, Bilinear		// Linear interpolation of 2 x 2 source texels, reducing uses a stretched triangle filter.
+		, Bicubic		// Catmull-Rom interpolation of 4 x 4 source texels, reducing uses a stretched Catmull-Rom filter.
+	};
+
+	// Type of a single channel of a texel, all channels of a texel share the same type.
+	enum class ResampleChannelType
+	{
+		  UInt8
+		, UInt16
+		, Float16
+		, Float32
+	};
+
+	struct ResamplerRegion
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	// A resample is cancelled once the generation no longer equals the generation it was started with.
+	struct ResampleCancellation
+	{
+		const std::atomic_uint64_t* generation;
+		uint64_t startGeneration;
+
+		bool IsCancelled() const { return generation->load(std::memory_order_relaxed) != startGeneration; }
+	};
+
+	struct ResamplerStatistics
+	{
+		uint64_t cancelledJobs;
+		uint64_t skippedRows; // Target rows left out by cancelled jobs.
+		uint64_t jobs;
+		uint64_t chunks; // Row chunks handed out to the threads.
+		// Load balance of the threads, busy time is the time a thread spent producing rows.
+		// busyTimeNs * jobs / (maxThreadBusyTimeNs * threads) is 1 when all threads were equally busy.
+		uint64_t busyTimeNs; // Sum of the busy time of all threads over all jobs.
+		uint64_t maxThreadBusyTimeNs; // Sum over all jobs of the busy time of the busiest thread.
+		uint64_t threads; // Sum over all jobs of the number of threads taking part.
+	};
+
+	// Source and target buffers share the same texel layout, the target buffer is tightly packed.
 	struct ResamplerParams
 	{
-		uint32_t* targetBuffer;
+		void* targetBuffer;
 		uint32_t targetWidth;
 		uint32_t targetHeight;
-		const uint32_t* sourceBuffer;
+		const void* sourceBuffer;
 		uint32_t sourceWidth;
 		uint32_t sourceHeight;
+		size_t sourceRowPitchInBytes = 0; // 0 - tightly packed.
+		ResampleChannelType channelType = ResampleChannelType::UInt8;
+		uint8_t numChannels = 4; // 1 to 4 channels.
+		// Part of the target image to produce, the target buffer holds only the region. An empty region produces the whole image.
+		ResamplerRegion targetRegion{};
+		ResampleFilter filter = ResampleFilter::Box;
+		SimdLevel simdLevel = SimdLevel::Best;
+		const ResampleCancellation* cancellation = nullptr; // Optional.
 	};
 
 	struct AverageParams
@@ -34,6 +96,7 @@ namespace OIV
 		const uint32_t* imageBuffer;
 		size_t ImageWidth;
 		size_t ImageHeight;
+		size_t ImageRowPitch; // in texels
 		size_t ImageX;
 		size_t ImageY;
 		ResamplerBox box;
@@ -42,20 +105,11 @@ namespace OIV
 
 	struct ResampleTask
 	{
-		size_t TaskID;
 		ResamplerParams resampleParams;
 		ResamplerBox box;
 		size_t totalTargetTexels;
-		double ratioX;
-		double ratioY;
-		size_t totalThreads;
-
-
-#if RESAMPLE_THREAD_POOL
-		std::condition_variable* cv;
-		std::mutex* mtx;
-		std::function<void()>* Callback;
-#endif
+		const FilterWeights* horizontalWeights;
+		const FilterWeights* verticalWeights;
 	};
 
 
@@ -63,18 +117,47 @@ namespace OIV
 	{
 
 	public:
-		void Resample(const ResamplerParams& params);
+		// 0 - use the ideal number of threads for memory bound operations.
+		explicit Resampler(uint32_t numThreads = 0);
+		// Returns false if the resample was cancelled, the target buffer is then partially written.
+		bool Resample(const ResamplerParams& params);
+		ResamplerStatistics GetStatistics() const;
+		static bool IsSupported(ResampleChannelType channelType, uint8_t numChannels);
 	private: // memeber functions
+		// Rows are handed out in chunks from a shared counter, threads which finish early take more chunks.
+		// Each chunk restarts the ring buffers and the horizontal pass, so a chunk is no smaller than MinRowsPerChunk.
+		static constexpr size_t ChunksPerThread = 4;
+		static constexpr size_t MinRowsPerChunk = 16;
+		static size_t GetRowsPerChunk(size_t totalRows, size_t numThreads);
 		void Init();
 		uint32_t GetAverageAt(const AverageParams& params);
-		void ResampleThreadEntryPoint(ResampleTask* task);
+		// Resample target rows [startY, endY), returns the number of rows skipped due to cancellation.
+		size_t ResampleRows(const ResampleTask& task, size_t startY, size_t endY);
+		// Each returns the number of rows completed before the resample was cancelled.
+		size_t ResampleBoxReference(const ResampleTask& task, size_t startY, size_t endY);
+		size_t ResampleBoxSeparable(const ResampleTask& task, size_t startY, size_t endY);
+		size_t ResamplePolyphase(const ResampleTask& task, size_t startY, size_t endY);
+		size_t ResampleNearest(const ResampleTask& task, size_t startY, size_t endY);
+		size_t ResampleInterpolated(const ResampleTask& task, size_t startY, size_t endY);
+		std::shared_ptr<const FilterWeights> GetFilterWeights(ResampleFilter filter, size_t sourceSize, size_t targetSize);
 
 
 
 	private: // memeber fields
-		std::vector<std::thread> fThreads;
-		std::vector<ResampleTask> fTasks;
+		using FilterWeightsKey = std::tuple<ResampleFilter, size_t, size_t>;
+		static constexpr size_t MaxCachedFilterWeights = 32;
+		std::map<FilterWeightsKey, std::shared_ptr<const FilterWeights>> fFilterWeights;
+		std::mutex fFilterWeightsMutex;
+		std::unique_ptr<ThreadPool> fThreadPool;
+		uint32_t fRequestedNumThreads = 0;
 		uint32_t fNumOfIdealThreadsForResampling = 1;
-		bool fInitialized = false;
+		std::once_flag fInitOnce;
+		std::atomic_uint64_t fCancelledJobs = 0;
+		std::atomic_uint64_t fSkippedRows = 0;
+		std::atomic_uint64_t fJobs = 0;
+		std::atomic_uint64_t fChunks = 0;
+		std::atomic_uint64_t fBusyTimeNs = 0;
+		std::atomic_uint64_t fMaxThreadBusyTimeNs = 0;
+		std::atomic_uint64_t fThreads = 0;
 	};
 }
\ No newline at end of file
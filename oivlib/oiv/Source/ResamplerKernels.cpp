@@ -0,0 +1,341 @@
+#include "ResamplerKernels.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+    #define OIV_RESAMPLER_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    #define OIV_RESAMPLER_NEON 1
+    #include <arm_neon.h>
+#endif
+
+// GCC and Clang (including clang-cl) only allow using intrinsics of instruction sets enabled for the function.
+#if defined(__GNUC__) || defined(__clang__)
+    #define OIV_TARGET_SSE2 __attribute__((target("sse2")))
+    #define OIV_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define OIV_TARGET_SSE2
+    #define OIV_TARGET_AVX2
+#endif
+
+namespace OIV
+{
+    namespace
+    {
+        constexpr size_t NumChannels = 4;
+
+        void SumRowSpansScalar(const uint8_t* sourceRow, const SourceSpan* spans, size_t numSpans, uint32_t* sums)
+        {
+            struct Color
+            {
+                uint8_t c0;
+                uint8_t c1;
+                uint8_t c2;
+                uint8_t c3;
+            };
+
+            const Color* texels = reinterpret_cast<const Color*>(sourceRow);
+            for (size_t i = 0; i < numSpans; i++)
+            {
+                const size_t end = spans[i].end;
+                uint32_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+                for (size_t x = spans[i].start; x < end; x++)
+                {
+                    c0 += texels[x].c0;
+                    c1 += texels[x].c1;
+                    c2 += texels[x].c2;
+                    c3 += texels[x].c3;
+                }
+
+                uint32_t* spanSums = sums + i * NumChannels;
+                spanSums[0] = c0;
+                spanSums[1] = c1;
+                spanSums[2] = c2;
+                spanSums[3] = c3;
+            }
+        }
+
+        void Average2x2Scalar(const uint8_t* sourceRow0, const uint8_t* sourceRow1, size_t targetWidth, uint8_t* targetRow)
+        {
+            for (size_t x = 0; x < targetWidth * NumChannels; x++)
+            {
+                const size_t source = (x / NumChannels) * NumChannels * 2 + x % NumChannels;
+                targetRow[x] = static_cast<uint8_t>((sourceRow0[source] + sourceRow0[source + NumChannels]
+                    + sourceRow1[source] + sourceRow1[source + NumChannels] + 2) / 4);
+            }
+        }
+
+#if OIV_RESAMPLER_X86 == 1
+        // Sum the remainder of a span that is shorter than a full vector, 'accum' holds the 4 channel sums.
+        OIV_TARGET_SSE2 inline __m128i SumTailSSE2(const uint8_t* sourceRow, size_t x, size_t end, __m128i accum)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 4 <= end; x += 4)
+            {
+                // Widen 4 texels to 16 bit, add texels (0,2) and (1,3), then widen the 2 partial sums to 32 bit.
+                const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sourceRow + x * NumChannels));
+                const __m128i pairs = _mm_add_epi16(_mm_unpacklo_epi8(texels, zero), _mm_unpackhi_epi8(texels, zero));
+                accum = _mm_add_epi32(accum, _mm_unpacklo_epi16(pairs, zero));
+                accum = _mm_add_epi32(accum, _mm_unpackhi_epi16(pairs, zero));
+            }
+
+            if (x + 2 <= end)
+            {
+                const __m128i texels = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(sourceRow + x * NumChannels));
+                const __m128i wide = _mm_unpacklo_epi8(texels, zero);
+                accum = _mm_add_epi32(accum, _mm_unpacklo_epi16(wide, zero));
+                accum = _mm_add_epi32(accum, _mm_unpackhi_epi16(wide, zero));
+                x += 2;
+            }
+
+            if (x < end)
+            {
+                uint32_t texel;
+                memcpy(&texel, sourceRow + x * NumChannels, sizeof(texel));
+                const __m128i wide = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(texel)), zero);
+                accum = _mm_add_epi32(accum, _mm_unpacklo_epi16(wide, zero));
+            }
+            return accum;
+        }
+
+        OIV_TARGET_SSE2 void SumRowSpansSSE2(const uint8_t* sourceRow, const SourceSpan* spans, size_t numSpans, uint32_t* sums)
+        {
+            for (size_t i = 0; i < numSpans; i++)
+            {
+                const __m128i accum = SumTailSSE2(sourceRow, spans[i].start, spans[i].end, _mm_setzero_si128());
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i * NumChannels), accum);
+            }
+        }
+
+        OIV_TARGET_AVX2 void SumRowSpansAVX2(const uint8_t* sourceRow, const SourceSpan* spans, size_t numSpans, uint32_t* sums)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            for (size_t i = 0; i < numSpans; i++)
+            {
+                size_t x = spans[i].start;
+                const size_t end = spans[i].end;
+                __m256i accum = _mm256_setzero_si256();
+                for (; x + 8 <= end; x += 8)
+                {
+                    // Same as SSE2 but on 8 texels, each 128 bit lane accumulates its own 4 texels.
+                    const __m256i texels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sourceRow + x * NumChannels));
+                    const __m256i pairs = _mm256_add_epi16(_mm256_unpacklo_epi8(texels, zero), _mm256_unpackhi_epi8(texels, zero));
+                    accum = _mm256_add_epi32(accum, _mm256_unpacklo_epi16(pairs, zero));
+                    accum = _mm256_add_epi32(accum, _mm256_unpackhi_epi16(pairs, zero));
+                }
+
+                const __m128i lanes = _mm_add_epi32(_mm256_castsi256_si128(accum), _mm256_extracti128_si256(accum, 1));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i * NumChannels), SumTailSSE2(sourceRow, x, end, lanes));
+            }
+        }
+
+        // Sum horizontally adjacent pairs of texels, 'sums' holds 2 texels widened to 16 bit,
+        // the pair sum is returned in the low 64 bits.
+        OIV_TARGET_SSE2 inline __m128i SumTexelPairSSE2(__m128i sums)
+        {
+            return _mm_add_epi16(sums, _mm_srli_si128(sums, 8));
+        }
+
+        OIV_TARGET_SSE2 void Average2x2SSE2(const uint8_t* sourceRow0, const uint8_t* sourceRow1, size_t targetWidth, uint8_t* targetRow)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i rounding = _mm_set1_epi16(2);
+            size_t x = 0;
+            for (; x + 4 <= targetWidth; x += 4)
+            {
+                // 8 source texels of each row, widened to 16 bit and summed vertically, 2 texels per register.
+                const __m128i row0a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sourceRow0 + x * 2 * NumChannels));
+                const __m128i row0b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sourceRow0 + x * 2 * NumChannels + 16));
+                const __m128i row1a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sourceRow1 + x * 2 * NumChannels));
+                const __m128i row1b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sourceRow1 + x * 2 * NumChannels + 16));
+                const __m128i texels01 = _mm_add_epi16(_mm_unpacklo_epi8(row0a, zero), _mm_unpacklo_epi8(row1a, zero));
+                const __m128i texels23 = _mm_add_epi16(_mm_unpackhi_epi8(row0a, zero), _mm_unpackhi_epi8(row1a, zero));
+                const __m128i texels45 = _mm_add_epi16(_mm_unpacklo_epi8(row0b, zero), _mm_unpacklo_epi8(row1b, zero));
+                const __m128i texels67 = _mm_add_epi16(_mm_unpackhi_epi8(row0b, zero), _mm_unpackhi_epi8(row1b, zero));
+
+                // Then horizontally, leaving the sums of target texels (0,1) and (2,3).
+                const __m128i sums01 = _mm_unpacklo_epi64(SumTexelPairSSE2(texels01), SumTexelPairSSE2(texels23));
+                const __m128i sums23 = _mm_unpacklo_epi64(SumTexelPairSSE2(texels45), SumTexelPairSSE2(texels67));
+                const __m128i average01 = _mm_srli_epi16(_mm_add_epi16(sums01, rounding), 2);
+                const __m128i average23 = _mm_srli_epi16(_mm_add_epi16(sums23, rounding), 2);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(targetRow + x * NumChannels), _mm_packus_epi16(average01, average23));
+            }
+
+            Average2x2Scalar(sourceRow0 + x * 2 * NumChannels, sourceRow1 + x * 2 * NumChannels, targetWidth - x, targetRow + x * NumChannels);
+        }
+
+        void CpuId(int info[4], int function, int subFunction)
+        {
+#if defined(_MSC_VER)
+            __cpuidex(info, function, subFunction);
+#else
+            __asm__ __volatile__("cpuid" : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3]) : "a"(function), "c"(subFunction));
+#endif
+        }
+
+        uint64_t GetXCR0()
+        {
+#if defined(_MSC_VER)
+            return _xgetbv(0);
+#else
+            uint32_t eax, edx;
+            __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+        }
+
+        bool IsAVX2Supported()
+        {
+            int info[4]{};
+            CpuId(info, 0, 0);
+            if (info[0] < 7)
+                return false;
+
+            CpuId(info, 1, 0);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            // The OS must preserve the XMM and YMM registers on context switch.
+            if (osxsave == false || avx == false || (GetXCR0() & 0x6) != 0x6)
+                return false;
+
+            CpuId(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+        }
+
+        bool IsSSE2Supported()
+        {
+            int info[4]{};
+            CpuId(info, 1, 0);
+            return (info[3] & (1 << 26)) != 0;
+        }
+#endif
+
+#if OIV_RESAMPLER_NEON == 1
+        void SumRowSpansNEON(const uint8_t* sourceRow, const SourceSpan* spans, size_t numSpans, uint32_t* sums)
+        {
+            for (size_t i = 0; i < numSpans; i++)
+            {
+                size_t x = spans[i].start;
+                const size_t end = spans[i].end;
+                uint32x4_t accum = vdupq_n_u32(0);
+                for (; x + 4 <= end; x += 4)
+                {
+                    // Widen and add texels (0,2) and (1,3), then widen the 2 partial sums into the accumulator.
+                    const uint8x16_t texels = vld1q_u8(sourceRow + x * NumChannels);
+                    const uint16x8_t pairs = vaddl_u8(vget_low_u8(texels), vget_high_u8(texels));
+                    accum = vaddw_u16(accum, vget_low_u16(pairs));
+                    accum = vaddw_u16(accum, vget_high_u16(pairs));
+                }
+
+                for (; x < end; x++)
+                {
+                    const uint8x8_t texel = vcreate_u8(static_cast<uint64_t>(sourceRow[x * NumChannels])
+                        | static_cast<uint64_t>(sourceRow[x * NumChannels + 1]) << 8
+                        | static_cast<uint64_t>(sourceRow[x * NumChannels + 2]) << 16
+                        | static_cast<uint64_t>(sourceRow[x * NumChannels + 3]) << 24);
+                    accum = vaddw_u16(accum, vget_low_u16(vmovl_u8(texel)));
+                }
+
+                vst1q_u32(sums + i * NumChannels, accum);
+            }
+        }
+
+        void Average2x2NEON(const uint8_t* sourceRow0, const uint8_t* sourceRow1, size_t targetWidth, uint8_t* targetRow)
+        {
+            size_t x = 0;
+            for (; x + 4 <= targetWidth; x += 4)
+            {
+                // Deinterleave 8 source texels of each row into even and odd texels, sum them widened to 16 bit
+                // and narrow back with a rounding shift.
+                const uint32x4x2_t row0 = vld2q_u32(reinterpret_cast<const uint32_t*>(sourceRow0 + x * 2 * NumChannels));
+                const uint32x4x2_t row1 = vld2q_u32(reinterpret_cast<const uint32_t*>(sourceRow1 + x * 2 * NumChannels));
+                const uint8x16_t even0 = vreinterpretq_u8_u32(row0.val[0]);
+                const uint8x16_t odd0 = vreinterpretq_u8_u32(row0.val[1]);
+                const uint8x16_t even1 = vreinterpretq_u8_u32(row1.val[0]);
+                const uint8x16_t odd1 = vreinterpretq_u8_u32(row1.val[1]);
+                const uint16x8_t sumsLow = vaddq_u16(vaddl_u8(vget_low_u8(even0), vget_low_u8(odd0)), vaddl_u8(vget_low_u8(even1), vget_low_u8(odd1)));
+                const uint16x8_t sumsHigh = vaddq_u16(vaddl_u8(vget_high_u8(even0), vget_high_u8(odd0)), vaddl_u8(vget_high_u8(even1), vget_high_u8(odd1)));
+                vst1q_u8(targetRow + x * NumChannels, vcombine_u8(vrshrn_n_u16(sumsLow, 2), vrshrn_n_u16(sumsHigh, 2)));
+            }
+
+            Average2x2Scalar(sourceRow0 + x * 2 * NumChannels, sourceRow1 + x * 2 * NumChannels, targetWidth - x, targetRow + x * NumChannels);
+        }
+#endif
+
+        constexpr ResamplerKernels ScalarKernels{ SimdLevel::Scalar, &SumRowSpansScalar, &Average2x2Scalar };
+#if OIV_RESAMPLER_X86 == 1
+        constexpr ResamplerKernels SSE2Kernels{ SimdLevel::SSE2, &SumRowSpansSSE2, &Average2x2SSE2 };
+        // The 2 x 2 average is bound by memory bandwidth, wider registers don't pay off.
+        constexpr ResamplerKernels AVX2Kernels{ SimdLevel::AVX2, &SumRowSpansAVX2, &Average2x2SSE2 };
+#endif
+#if OIV_RESAMPLER_NEON == 1
+        constexpr ResamplerKernels NEONKernels{ SimdLevel::NEON, &SumRowSpansNEON, &Average2x2NEON };
+#endif
+    }
+
+    SimdLevel ResamplerKernels::GetBestSupportedLevel()
+    {
+        static const SimdLevel bestLevel = []
+        {
+#if OIV_RESAMPLER_X86 == 1
+            if (IsAVX2Supported())
+                return SimdLevel::AVX2;
+            if (IsSSE2Supported())
+                return SimdLevel::SSE2;
+#elif OIV_RESAMPLER_NEON == 1
+            return SimdLevel::NEON;
+#endif
+            return SimdLevel::Scalar;
+        }();
+
+        return bestLevel;
+    }
+
+    bool ResamplerKernels::IsSupported(SimdLevel level)
+    {
+        switch (level)
+        {
+        case SimdLevel::Best:
+        case SimdLevel::Scalar:
+            return true;
+#if OIV_RESAMPLER_X86 == 1
+        case SimdLevel::SSE2:
+            return GetBestSupportedLevel() == SimdLevel::SSE2 || GetBestSupportedLevel() == SimdLevel::AVX2;
+        case SimdLevel::AVX2:
+            return GetBestSupportedLevel() == SimdLevel::AVX2;
+#elif OIV_RESAMPLER_NEON == 1
+        case SimdLevel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    const ResamplerKernels& ResamplerKernels::Get(SimdLevel level)
+    {
+        if (level == SimdLevel::Best)
+            level = GetBestSupportedLevel();
+
+        if (IsSupported(level) == false)
+            return ScalarKernels;
+
+        switch (level)
+        {
+#if OIV_RESAMPLER_X86 == 1
+        case SimdLevel::SSE2:
+            return SSE2Kernels;
+        case SimdLevel::AVX2:
+            return AVX2Kernels;
+#elif OIV_RESAMPLER_NEON == 1
+        case SimdLevel::NEON:
+            return NEONKernels;
+#endif
+        default:
+            return ScalarKernels;
+        }
+    }
+}
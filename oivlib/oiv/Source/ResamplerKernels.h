@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace OIV
+{
+    // Half open range of source texels along a single axis.
+    struct SourceSpan
+    {
+        size_t start;
+        size_t end;
+    };
+
+    enum class SimdLevel
+    {
+          Best      // Best instruction set supported by the running CPU.
+        , Scalar
+        , SSE2
+        , AVX2
+        , NEON
+    };
+
+    // For each span sum the 4 x 8 bit channels of the texels in the span of a single row,
+    // channel sums of span i are written to sums[i * 4 .. i * 4 + 3].
+    using SumRowSpansFunc = void (*)(const uint8_t* sourceRow, const SourceSpan* spans, size_t numSpans, uint32_t* sums);
+
+    // Average each 2 x 2 block of 8 bit RGBA texels of two consecutive rows into a single texel, rounded to nearest.
+    // Each source row holds at least 2 * targetWidth texels.
+    using Average2x2Func = void (*)(const uint8_t* sourceRow0, const uint8_t* sourceRow1, size_t targetWidth, uint8_t* targetRow);
+
+    struct ResamplerKernels
+    {
+        SimdLevel level;
+        SumRowSpansFunc sumRowSpans;
+        Average2x2Func average2x2;
+
+        static SimdLevel GetBestSupportedLevel();
+        static bool IsSupported(SimdLevel level);
+        // Returns the kernels of the requested level, or the scalar kernels if the level is not supported by the CPU.
+        static const ResamplerKernels& Get(SimdLevel level);
+    };
+}
@@ -0,0 +1,99 @@
+#include "ResamplerWeights.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+namespace OIV
+{
+    namespace
+    {
+        double Sinc(double x)
+        {
+            if (x == 0.0)
+                return 1.0;
+
+            const double px = std::numbers::pi * x;
+            return std::sin(px) / px;
+        }
+
+        double Lanczos(double x)
+        {
+            x = std::abs(x);
+            return x < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0.0;
+        }
+
+        double Tent(double x)
+        {
+            x = std::abs(x);
+            return x < 1.0 ? 1.0 - x : 0.0;
+        }
+
+        // Mitchell-Netravali family of cubic filters.
+        template <int BTimes6, int CTimes6>
+        double BCCubic(double x)
+        {
+            constexpr double B = BTimes6 / 6.0;
+            constexpr double C = CTimes6 / 6.0;
+            x = std::abs(x);
+            if (x < 1.0)
+                return ((12 - 9 * B - 6 * C) * x * x * x + (-18 + 12 * B + 6 * C) * x * x + (6 - 2 * B)) / 6.0;
+            if (x < 2.0)
+                return ((-B - 6 * C) * x * x * x + (6 * B + 30 * C) * x * x + (-12 * B - 48 * C) * x + (8 * B + 24 * C)) / 6.0;
+            return 0.0;
+        }
+    }
+
+    const FilterKernel FilterKernel::Lanczos3{ 3.0, &Lanczos };
+    const FilterKernel FilterKernel::Mitchell{ 2.0, &BCCubic<2, 2> }; // B = 1/3, C = 1/3
+    const FilterKernel FilterKernel::CatmullRom{ 2.0, &BCCubic<0, 3> }; // B = 0, C = 1/2
+    const FilterKernel FilterKernel::Triangle{ 1.0, &Tent };
+
+    FilterWeights FilterWeights::Create(const FilterKernel& kernel, size_t sourceSize, size_t targetSize)
+    {
+        const double ratio = static_cast<double>(sourceSize) / targetSize;
+        // When downscaling the kernel is stretched over the source texels covered by a target texel.
+        const double filterScale = std::max(ratio, 1.0);
+        const double support = kernel.support * filterScale;
+
+        FilterWeights result;
+        result.contributors.reserve(targetSize);
+        result.weights.reserve(targetSize * static_cast<size_t>(std::ceil(support * 2 + 1)));
+
+        for (size_t target = 0; target < targetSize; target++)
+        {
+            const double center = (target + 0.5) * ratio - 0.5;
+            const int64_t start = std::max<int64_t>(static_cast<int64_t>(std::ceil(center - support)), 0);
+            const int64_t end = std::min<int64_t>(static_cast<int64_t>(std::floor(center + support)) + 1, static_cast<int64_t>(sourceSize));
+
+            Contributors contributors{ static_cast<size_t>(start), static_cast<size_t>(end - start), result.weights.size() };
+
+            double sum = 0.0;
+            for (int64_t source = start; source < end; source++)
+            {
+                const double weight = kernel.evaluate((source - center) / filterScale);
+                result.weights.push_back(static_cast<float>(weight));
+                sum += weight;
+            }
+
+            if (sum != 0.0)
+            {
+                // Normalize, so the weights of texels clipped by the image edges are redistributed.
+                for (size_t i = contributors.weightsOffset; i < result.weights.size(); i++)
+                    result.weights[i] = static_cast<float>(result.weights[i] / sum);
+            }
+            else
+            {
+                // Degenerate window, take the nearest source texel.
+                const size_t nearest = std::min(static_cast<size_t>(std::max(center + 0.5, 0.0)), sourceSize - 1);
+                result.weights.resize(contributors.weightsOffset);
+                result.weights.push_back(1.0f);
+                contributors = { nearest, 1, contributors.weightsOffset };
+            }
+
+            result.contributors.push_back(contributors);
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace OIV
+{
+    struct FilterKernel
+    {
+        double support; // Radius of the kernel in source texels when not downscaling.
+        double (*evaluate)(double x);
+
+        static const FilterKernel Lanczos3;
+        static const FilterKernel Mitchell;
+        static const FilterKernel CatmullRom;
+        static const FilterKernel Triangle;
+    };
+
+    // The source texels contributing to every target texel along a single axis and their normalized weights.
+    struct FilterWeights
+    {
+        struct Contributors
+        {
+            size_t start;
+            size_t count;
+            size_t weightsOffset;
+        };
+
+        std::vector<Contributors> contributors;
+        std::vector<float> weights;
+
+        static FilterWeights Create(const FilterKernel& kernel, size_t sourceSize, size_t targetSize);
+    };
+}
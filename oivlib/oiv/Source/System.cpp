@@ -1,26 +1,148 @@
 #include "System.h"
-#include <LLUtils/Exception.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <LLUtils/PlatformUtility.h>
+#include "ResamplerKernels.h"
+#include "ThreadPool.h"
+
 namespace OIV
 {
-	uint32_t System::GetIdealNumThreadsForMemoryOperations()
+	namespace
 	{
-		auto cpuCoresInfo = LLUtils::PlatformUtility::GetCPUCoresInfo();
+		// Bump when the calibration changes, so cached results are measured again.
+		constexpr uint32_t CalibrationVersion = 1;
+		// The calibration kernel averages 2 x 2 blocks of a source larger than the last level cache of most CPUs.
+		constexpr size_t CalibrationWidth = 4096;
+		constexpr size_t CalibrationHeight = 2048;
+		constexpr size_t CalibrationRepetitions = 3;
+		// Prefer fewer threads when they are within this fraction of the best throughput, leaving cores for the rest of the system.
+		constexpr double CalibrationTolerance = 0.95;
+
+		uint32_t GetNumLogicalCores()
+		{
+			const auto cpuCoresInfo = LLUtils::PlatformUtility::GetCPUCoresInfo();
+			const uint32_t logicalCores = std::max(static_cast<uint32_t>(cpuCoresInfo.logicalCores), std::thread::hardware_concurrency());
+			return std::max(logicalCores, 1u);
+		}
+
+		std::filesystem::path GetCalibrationCachePath()
+		{
+			return std::filesystem::path(LLUtils::PlatformUtility::GetAppDataFolder()) / "OIV" / "ThreadCalibration.txt";
+		}
+
+		// Returns 0 if there is no valid cached result for this machine.
+		uint32_t LoadCalibration(uint32_t logicalCores)
+		{
+			std::ifstream file(GetCalibrationCachePath());
+			uint32_t version = 0;
+			uint32_t cachedLogicalCores = 0;
+			uint32_t numThreads = 0;
+			if (!(file >> version >> cachedLogicalCores >> numThreads) || version != CalibrationVersion || cachedLogicalCores != logicalCores)
+				return 0;
+
+			return numThreads >= 1 && numThreads <= logicalCores ? numThreads : 0;
+		}
 
-		if (cpuCoresInfo.logicalCores > cpuCoresInfo.physicalCores)
+		void SaveCalibration(uint32_t logicalCores, uint32_t numThreads)
 		{
-			if (cpuCoresInfo.physicalCores * 2 == cpuCoresInfo.logicalCores)
+			// A read only app data folder only costs a calibration on the next run.
+			const std::filesystem::path cachePath = GetCalibrationCachePath();
+			std::error_code error;
+			std::filesystem::create_directories(cachePath.parent_path(), error);
+			std::ofstream file(cachePath, std::ios::trunc);
+			file << CalibrationVersion << ' ' << logicalCores << ' ' << numThreads << '\n';
+		}
+
+		// 1, 2, 3, 4, 6, 9 ... grows by half up to the number of logical cores, which is always measured.
+		std::vector<uint32_t> GetCalibrationCandidates(uint32_t logicalCores)
+		{
+			std::vector<uint32_t> candidates;
+			for (uint32_t numThreads = 1; numThreads < logicalCores; numThreads = std::max(numThreads + 1, numThreads * 3 / 2))
+				candidates.push_back(numThreads);
+
+			candidates.push_back(logicalCores);
+			return candidates;
+		}
+	}
+
+	uint32_t System::CalibrateNumThreadsForMemoryOperations()
+	{
+		const uint32_t logicalCores = GetNumLogicalCores();
+		const size_t targetWidth = CalibrationWidth / 2;
+		const size_t targetHeight = CalibrationHeight / 2;
+		std::vector<uint8_t> source(CalibrationWidth * CalibrationHeight * 4, 0x5A);
+		std::vector<uint8_t> target(targetWidth * targetHeight * 4);
+		const Average2x2Func average2x2 = ResamplerKernels::Get(SimdLevel::Best).average2x2;
+
+		uint32_t bestNumThreads = 1;
+		double bestRowsPerSecond = 0.0;
+		std::vector<std::pair<uint32_t, double>> measurements;
+		for (uint32_t numThreads : GetCalibrationCandidates(logicalCores))
+		{
+			ThreadPool threadPool(numThreads - 1);
+			auto run = [&]
 			{
-				// with hyper threading it seems like resampling works best on 75% of the virtual/ logical cores.
-				return static_cast<uint32_t>(cpuCoresInfo.physicalCores * 1.5);
-			}
-			else
+				threadPool.ParallelFor(numThreads, [&](size_t taskIndex)
+					{
+						const size_t startY = taskIndex * targetHeight / numThreads;
+						const size_t endY = (taskIndex + 1) * targetHeight / numThreads;
+						for (size_t y = startY; y < endY; y++)
+						{
+							const uint8_t* sourceRow = source.data() + y * 2 * CalibrationWidth * 4;
+							average2x2(sourceRow, sourceRow + CalibrationWidth * 4, targetWidth, target.data() + y * targetWidth * 4);
+						}
+					});
+			};
+
+			run(); // Warm up, the worker threads and the pages of the target buffer.
+			double bestSeconds = std::numeric_limits<double>::max();
+			for (size_t i = 0; i < CalibrationRepetitions; i++)
 			{
-				LL_EXCEPTION_NOT_IMPLEMENT("Unknown CPU cores layout");
+				const auto start = std::chrono::steady_clock::now();
+				run();
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
 			}
+
+			const double rowsPerSecond = targetHeight / std::max(bestSeconds, 1e-9);
+			measurements.emplace_back(numThreads, rowsPerSecond);
+			if (rowsPerSecond > bestRowsPerSecond)
+				bestRowsPerSecond = rowsPerSecond;
 		}
-		else
+
+		for (const auto& [numThreads, rowsPerSecond] : measurements)
 		{
-			return cpuCoresInfo.physicalCores; // no hyper threading.
+			if (rowsPerSecond >= bestRowsPerSecond * CalibrationTolerance)
+			{
+				bestNumThreads = numThreads;
+				break;
+			}
 		}
+
+		return bestNumThreads;
+	}
+
+	uint32_t System::GetIdealNumThreadsForMemoryOperations()
+	{
+		static std::once_flag sCalibrateOnce;
+		static uint32_t sIdealNumThreads = 1;
+		std::call_once(sCalibrateOnce, []
+			{
+				const uint32_t logicalCores = GetNumLogicalCores();
+				sIdealNumThreads = LoadCalibration(logicalCores);
+				if (sIdealNumThreads == 0)
+				{
+					sIdealNumThreads = CalibrateNumThreadsForMemoryOperations();
+					SaveCalibration(logicalCores, sIdealNumThreads);
+				}
+			});
+
+		return sIdealNumThreads;
 	}
-}
\ No newline at end of file
+}
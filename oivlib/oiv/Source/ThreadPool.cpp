@@ -0,0 +1,135 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace OIV
+{
+    ThreadPool::ThreadPool(uint32_t numThreads)
+    {
+        fThreads.reserve(numThreads);
+        for (uint32_t i = 0; i < numThreads; i++)
+            fThreads.emplace_back(&ThreadPool::WorkerEntryPoint, this);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fStopping = true;
+        }
+        fJobAvailable.notify_all();
+
+        for (std::thread& thread : fThreads)
+            thread.join();
+    }
+
+    uint32_t ThreadPool::GetNumThreads() const
+    {
+        return static_cast<uint32_t>(fThreads.size());
+    }
+
+    void ThreadPool::Enqueue(Job job)
+    {
+        if (fThreads.empty())
+        {
+            // No workers, run in place.
+            job();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fJobs.push_back(std::move(job));
+        }
+        fJobAvailable.notify_one();
+    }
+
+    void ThreadPool::ClearPendingJobs()
+    {
+        std::deque<Job> jobs;
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            jobs.swap(fJobs);
+        }
+        // The jobs are destroyed here, outside of the lock.
+    }
+
+    void ThreadPool::WorkerEntryPoint()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(fMutex);
+                fJobAvailable.wait(lock, [this] { return fStopping || fJobs.empty() == false; });
+                if (fJobs.empty())
+                    return; // Stopping and no more pending jobs.
+
+                job = std::move(fJobs.front());
+                fJobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    void ThreadPool::ParallelFor(size_t numTasks, const ParallelJob& job)
+    {
+        if (numTasks == 0)
+            return;
+
+        // The batch is shared with the workers, a worker may pick up its job after all the tasks are done
+        // and this function has returned.
+        struct Batch
+        {
+            const ParallelJob* job;
+            size_t numTasks;
+            std::atomic_size_t nextTask{};
+            std::atomic_size_t completedTasks{};
+            std::mutex mutex;
+            std::condition_variable done;
+            std::exception_ptr error;
+        };
+
+        auto batch = std::make_shared<Batch>();
+        batch->job = &job;
+        batch->numTasks = numTasks;
+
+        auto runTasks = [batch]()
+        {
+            size_t taskIndex;
+            while ((taskIndex = batch->nextTask++) < batch->numTasks)
+            {
+                try
+                {
+                    (*batch->job)(taskIndex);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(batch->mutex);
+                    if (batch->error == nullptr)
+                        batch->error = std::current_exception();
+                }
+
+                if (++batch->completedTasks == batch->numTasks)
+                {
+                    std::lock_guard<std::mutex> lock(batch->mutex);
+                    batch->done.notify_all();
+                }
+            }
+        };
+
+        const size_t numHelpers = std::min<size_t>(fThreads.size(), numTasks - 1);
+        for (size_t i = 0; i < numHelpers; i++)
+            Enqueue(runTasks);
+
+        runTasks();
+
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        batch->done.wait(lock, [&batch] { return batch->completedTasks == batch->numTasks; });
+
+        if (batch->error != nullptr)
+            std::rethrow_exception(batch->error);
+    }
+}
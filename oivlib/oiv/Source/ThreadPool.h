@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OIV
+{
+    // A fixed set of long lived worker threads, parked on a condition variable between jobs.
+    class ThreadPool
+    {
+    public:
+        using Job = std::function<void()>;
+        using ParallelJob = std::function<void(size_t taskIndex)>;
+
+        ThreadPool(uint32_t numThreads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        uint32_t GetNumThreads() const;
+        void Enqueue(Job job);
+        // Discard the jobs that haven't started yet, running jobs are not waited for.
+        void ClearPendingJobs();
+        // Execute job(taskIndex) for each task index in [0, numTasks) and block until all tasks are done.
+        // The calling thread takes part in executing the tasks, exceptions are rethrown in the calling thread.
+        void ParallelFor(size_t numTasks, const ParallelJob& job);
+
+    private: // methods
+        void WorkerEntryPoint();
+
+    private: // member fields
+        std::vector<std::thread> fThreads;
+        std::deque<Job> fJobs;
+        std::mutex fMutex;
+        std::condition_variable fJobAvailable;
+        bool fStopping = false;
+    };
+}
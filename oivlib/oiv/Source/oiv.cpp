@@ -9,6 +9,8 @@
 #include <functions.h>
 #include <Version.h>
 #include "Interfaces/IRendererDefs.h"
+#include <LLUtils/StringUtility.h>
+#include <OIVImage/OIVRawImage.h>
 
 #if OIV_BUILD_RENDERER_D3D11 == 1
 #include <OIVD3D11RendererFactory.h>
@@ -21,6 +23,12 @@
 
 namespace OIV
 {
+    OIV::~OIV()
+    {
+        // Don't keep the process alive for pyramids that no one will use.
+        CancelMipPyramidBuilds();
+    }
+
     IRenderer* OIV::GetRenderer() 
     {
         return fRenderer.get();
@@ -46,25 +54,40 @@ namespace OIV
         fRenderer->SetViewParams(fViewParams);
     }
 
-    IMUtil::AxisAlignedRotation OIV::ResolveExifRotation(unsigned short exifRotation) const
+    IMUtil::AxisAlignedTransform OIV::ResolveExifRotation(unsigned short exifRotation) const
     {
         using namespace IMUtil;
-        AxisAlignedRotation rotation;
-            switch (exifRotation)
-            {
-            case 3:
-                rotation = AxisAlignedRotation::Rotate180;
-                break;
-            case 6:
-                rotation = AxisAlignedRotation::Rotate90CW;
-                break;
-            case 8:
-                rotation = AxisAlignedRotation::Rotate90CCW;
-                break;
-            default:
-                rotation = AxisAlignedRotation::None;
-            }
-            return rotation;
+        // In OIV as opposed to EXIF, rotation is done first, then flip, so mirrored and rotated orientations flip vertically.
+        AxisAlignedTransform transform{};
+        switch (exifRotation)
+        {
+        case 2:
+            transform.flip = AxisAlignedFlip::Horizontal;
+            break;
+        case 3:
+            transform.rotation = AxisAlignedRotation::Rotate180;
+            break;
+        case 4:
+            transform.flip = AxisAlignedFlip::Vertical;
+            break;
+        case 5:
+            transform.rotation = AxisAlignedRotation::Rotate90CCW;
+            transform.flip = AxisAlignedFlip::Vertical;
+            break;
+        case 6:
+            transform.rotation = AxisAlignedRotation::Rotate90CW;
+            break;
+        case 7:
+            transform.rotation = AxisAlignedRotation::Rotate90CW;
+            transform.flip = AxisAlignedFlip::Vertical;
+            break;
+        case 8:
+            transform.rotation = AxisAlignedRotation::Rotate90CCW;
+            break;
+        default:
+            break;
+        }
+        return transform;
     }
 
     IRendererSharedPtr OIV::CreateBestRenderer()
@@ -96,11 +119,97 @@ namespace OIV
         LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Bad build configuration");
     }
 
-    IMCodec::ImageSharedPtr OIV::Resample(IMCodec::ImageSharedPtr sourceImage, LLUtils::PointI32 targetSize)
+    bool OIV::GetResamplerTexelLayout(IMCodec::TexelFormat texelFormat, ResampleChannelType& channelType, uint8_t& numChannels) const
+    {
+        using namespace IMCodec;
+        // The box average is computed per channel, so the order of the channels doesn't matter.
+        switch (texelFormat)
+        {
+        case TexelFormat::I_R8_G8_B8_A8:
+        case TexelFormat::I_B8_G8_R8_A8:
+        case TexelFormat::I_A8_R8_G8_B8:
+        case TexelFormat::I_A8_B8_G8_R8:
+            channelType = ResampleChannelType::UInt8;
+            numChannels = 4;
+            return true;
+        case TexelFormat::I_R8_G8_B8:
+        case TexelFormat::I_B8_G8_R8:
+            channelType = ResampleChannelType::UInt8;
+            numChannels = 3;
+            return true;
+        case TexelFormat::I_A8:
+        case TexelFormat::I_X8:
+            channelType = ResampleChannelType::UInt8;
+            numChannels = 1;
+            return true;
+        case TexelFormat::I_R16_G16_B16_A16:
+        case TexelFormat::I_B16_G16_R16_A16:
+        case TexelFormat::I_A16_R16_G16_B16:
+        case TexelFormat::I_A16_B16_G16_R16:
+            channelType = ResampleChannelType::UInt16;
+            numChannels = 4;
+            return true;
+        case TexelFormat::I_R16_G16_B16:
+        case TexelFormat::I_B16_G16_R16:
+            channelType = ResampleChannelType::UInt16;
+            numChannels = 3;
+            return true;
+        case TexelFormat::I_X16:
+            channelType = ResampleChannelType::UInt16;
+            numChannels = 1;
+            return true;
+        case TexelFormat::F_X16:
+            channelType = ResampleChannelType::Float16;
+            numChannels = 1;
+            return true;
+        case TexelFormat::F_R32_G32_B32:
+            channelType = ResampleChannelType::Float32;
+            numChannels = 3;
+            return true;
+        case TexelFormat::F_X32:
+            channelType = ResampleChannelType::Float32;
+            numChannels = 1;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // An empty region stands for the whole target image.
+    bool OIV::IsValidResampleRegion(const OIV_RECT_I& targetRegion, LLUtils::PointI32 targetSize)
     {
+        if (targetRegion.x1 <= targetRegion.x0 || targetRegion.y1 <= targetRegion.y0)
+            return true;
+
+        return targetRegion.x0 >= 0 && targetRegion.y0 >= 0 && targetRegion.x1 <= targetSize.x && targetRegion.y1 <= targetSize.y;
+    }
 
-        const uint32_t width = targetSize.x;
-        const uint32_t height = targetSize.y;
+    IMCodec::ImageSharedPtr OIV::Resample(IMCodec::ImageSharedPtr sourceImage, LLUtils::PointI32 targetSize, OIV_Resample_Filter filter, const OIV_RECT_I& targetRegion, const ResampleCancellation* cancellation)
+    {
+        if (sourceImage == nullptr)
+            return nullptr;
+
+        ResampleChannelType channelType;
+        uint8_t numChannels;
+        if (GetResamplerTexelLayout(sourceImage->GetTexelFormat(), channelType, numChannels) == false)
+            return nullptr;
+
+        if (IsValidResampleRegion(targetRegion, targetSize) == false)
+            return nullptr;
+
+        ResamplerRegion region{};
+        if (targetRegion.x1 > targetRegion.x0 && targetRegion.y1 > targetRegion.y0)
+        {
+            region = { static_cast<uint32_t>(targetRegion.x0), static_cast<uint32_t>(targetRegion.y0)
+                , static_cast<uint32_t>(targetRegion.x1 - targetRegion.x0), static_cast<uint32_t>(targetRegion.y1 - targetRegion.y0) };
+        }
+        else
+        {
+            region = { 0, 0, static_cast<uint32_t>(targetSize.x), static_cast<uint32_t>(targetSize.y) };
+        }
+
+        const uint32_t width = region.width;
+        const uint32_t height = region.height;
 
 
         using namespace IMCodec;
@@ -116,14 +225,81 @@ namespace OIV
         
         ImageSharedPtr resampled = std::make_shared<IMCodec::Image>(imageItem,ImageItemType::Unknown);
         ResamplerParams params;
-        params.sourceBuffer = reinterpret_cast<const uint32_t*>(sourceImage->GetBufferAt(0, 0));
+        params.sourceBuffer = sourceImage->GetBufferAt(0, 0);
         params.sourceWidth = sourceImage->GetWidth();
         params.sourceHeight = sourceImage->GetHeight();
-        params.targetBuffer = const_cast<uint32_t*>(reinterpret_cast<const uint32_t*>(resampled->GetBufferAt(0, 0)));
-        params.targetWidth = width;
-        params.targetHeight = height;
+        params.sourceRowPitchInBytes = sourceImage->GetRowPitchInBytes();
+        params.targetWidth = targetSize.x;
+        params.targetHeight = targetSize.y;
+        params.channelType = channelType;
+        params.numChannels = numChannels;
+        params.cancellation = cancellation;
+
+        switch (filter)
+        {
+        case RF_Box:
+            params.filter = ResampleFilter::Box;
+            break;
+        case RF_Lanczos3:
+            params.filter = ResampleFilter::Lanczos3;
+            break;
+        case RF_Mitchell:
+            params.filter = ResampleFilter::Mitchell;
+            break;
+        case RF_CatmullRom:
+            params.filter = ResampleFilter::CatmullRom;
+            break;
+        case RF_Nearest:
+            params.filter = ResampleFilter::Nearest;
+            break;
+        case RF_Bilinear:
+            params.filter = ResampleFilter::Bilinear;
+            break;
+        case RF_Bicubic:
+            params.filter = ResampleFilter::Bicubic;
+            break;
+        default:
+            LL_EXCEPTION_UNEXPECTED_VALUE;
+        }
 
-        fResampler.Resample(params);
+        // Compose the region from resampled tiles, only tiles missing from the cache are resampled.
+        constexpr uint32_t tileSize = ResampleTileCache::TileSize;
+        const size_t bytesPerTexel = sourceImage->GetBytesPerTexel();
+        std::byte* targetBuffer = const_cast<std::byte*>(reinterpret_cast<const std::byte*>(resampled->GetBufferAt(0, 0)));
+
+        for (uint32_t tileY = region.y / tileSize; tileY * tileSize < region.y + region.height; tileY++)
+        {
+            for (uint32_t tileX = region.x / tileSize; tileX * tileSize < region.x + region.width; tileX++)
+            {
+                const ResamplerRegion tileRegion{ tileX * tileSize, tileY * tileSize
+                    , std::min(tileSize, params.targetWidth - tileX * tileSize), std::min(tileSize, params.targetHeight - tileY * tileSize) };
+
+                const ResampleTileCache::TileKey key{ sourceImage.get(), params.targetWidth, params.targetHeight, static_cast<uint32_t>(filter), tileX, tileY };
+                ResampleTileCache::TileData tile = fResampleTileCache.Find(key, sourceImage);
+                if (tile == nullptr)
+                {
+                    auto tileBuffer = std::make_shared<std::vector<std::byte>>(static_cast<size_t>(tileRegion.width) * tileRegion.height * bytesPerTexel);
+                    params.targetBuffer = tileBuffer->data();
+                    params.targetRegion = tileRegion;
+                    // A cancelled tile is partially written, don't cache it.
+                    if (fResampler.Resample(params) == false)
+                        return nullptr;
+                    tile = tileBuffer;
+                    fResampleTileCache.Insert(key, sourceImage, tile);
+                }
+
+                const uint32_t x0 = std::max(region.x, tileRegion.x);
+                const uint32_t x1 = std::min(region.x + region.width, tileRegion.x + tileRegion.width);
+                const uint32_t y0 = std::max(region.y, tileRegion.y);
+                const uint32_t y1 = std::min(region.y + region.height, tileRegion.y + tileRegion.height);
+                for (uint32_t y = y0; y < y1; y++)
+                {
+                    memcpy(targetBuffer + ((y - region.y) * static_cast<size_t>(width) + (x0 - region.x)) * bytesPerTexel
+                        , tile->data() + ((y - tileRegion.y) * static_cast<size_t>(tileRegion.width) + (x0 - tileRegion.x)) * bytesPerTexel
+                        , (x1 - x0) * bytesPerTexel);
+                }
+            }
+        }
 
         return resampled;
     }
@@ -133,93 +309,93 @@ namespace OIV
     // IPictureViewr implementation
     ResultCode OIV::LoadFile(void* buffer, std::size_t size, char* extension, OIV_CMD_LoadFile_Flags flags, ImageHandle& handle)
     {
+        if (buffer == nullptr || size == 0)
+            return RC_InvalidParameters;
 
-        return ResultCode::RC_NotImplemented;
-
-  //      if (buffer == nullptr || size == 0)
-  //          return RC_InvalidParameters;
-
-		//ResultCode result = RC_FileNotSupported;
-  //      using namespace IMCodec;
-  //      ImageSharedPtr image;
-  //      ImageLoaderFlags loadFlags = ((flags & OIV_CMD_LoadFile_Flags::OnlyRegisteredExtension) != 0) ? ImageLoaderFlags::OnlyRegisteredExtension : ImageLoaderFlags::None;
-  //      ImageResult loadResult = fImageLoader.Load(static_cast<const std::byte*>(buffer), size, extension,ImageLoadFlags::None, loadFlags, image);
-
-		//if (loadResult ==  ImageResult::Success)
-		//{
-		//	if (image != nullptr)
-		//	{
-		//		int exifOrientation = 0;
-		//		easyexif::EXIFInfo exifInfo;
-		//		if (flags & OIV_CMD_LoadFile_Flags::Load_Exif_Data
-		//			&& exifInfo.parseFrom(static_cast<const unsigned char*>(buffer), static_cast<unsigned int>(size)) == PARSE_EXIF_SUCCESS)
-		//			exifOrientation = exifInfo.Orientation;
-
-
-		//		if (exifOrientation != 0)
-		//		{
-  //                  
-		//			const_cast<ItemMetaData&>(image->GetMetaData()).exifData.orientation = exifOrientation;
-
-		//			// I see no use of using the original image, discard source image and use the image with exif rotation applied. 
-		//			// If needed, responsibility for exif rotation can be transferred to the user by returning MetaData.exifOrientation.
-		//			image = ApplyExifRotation(image);
+        using namespace IMCodec;
+        const PluginTraverseMode traverseMode = (flags & OIV_CMD_LoadFile_Flags::OnlyRegisteredExtension) != 0
+            ? PluginTraverseMode::NoTraverse : PluginTraverseMode::AnyPlugin | PluginTraverseMode::AnyFileType;
+        const std::wstring wideExtension = extension != nullptr ? LLUtils::StringUtility::ToWString(std::string(extension)) : std::wstring();
+
+        // Decode straight from the caller's buffer, the buffer is only read during the call.
+        ImageSharedPtr image;
+        if (GetImageLoader().Decode(static_cast<const std::byte*>(buffer), size, wideExtension, ImageLoadFlags::None, {}, traverseMode, image) != ImageResult::Success
+            || image == nullptr)
+            return RC_FileNotSupported;
+
+        unsigned short exifOrientation = 0;
+        easyexif::EXIFInfo exifInfo;
+        if ((flags & OIV_CMD_LoadFile_Flags::Load_Exif_Data) != 0
+            && exifInfo.parseFrom(static_cast<const unsigned char*>(buffer), static_cast<unsigned int>(size)) == PARSE_EXIF_SUCCESS)
+            exifOrientation = exifInfo.Orientation;
+
+        // I see no use of using the original image, discard source image and use the image with exif rotation applied.
+        ImageSharedPtr decoded = image;
+        if (exifOrientation > 1)
+            image = ApplyExifRotation(image, exifOrientation);
 
-		//		}
-		//		handle = fImageManager.AddImage(image);
+        handle = fImageManager.AddImage(image);
+        if (handle == ImageHandleNull)
+            return RC_InternalError;
 
-		//		for (size_t i = 0; i < image->GetNumSubImages(); i++)
-		//		{
+        // The sub-images are already decoded. Oriented sub-images are created on first access, opening a multi-page file
+        // to view one page orients one page. Each loader holds only its own decoded sub-image, which is counted as held memory,
+        // the oriented copy may be evicted and is oriented again when accessed.
+        for (uint16_t i = 0; i < decoded->GetNumSubImages(); i++)
+        {
+            ImageSharedPtr subImage = decoded->GetSubImage(i);
+            if (subImage == nullptr)
+                continue;
 
-		//			if (exifOrientation != 0)
-  //                      image->SetSubImage(i, ApplyExifRotation(image->GetSubImage(i)));
+            if (exifOrientation > 1)
+            {
+                fImageManager.AddLazyChildImage([this, subImage, exifOrientation]() -> ImageSharedPtr
+                    {
+                        return ApplyExifRotation(subImage, exifOrientation);
+                    }, handle, subImage);
+            }
+            else
+            {
+                fImageManager.AddChildImage(subImage, handle);
+            }
+        }
 
-		//			fImageManager.AddChildImage(image->GetSubImage(i), handle);
-		//		}
-		//		result = RC_Success;
-		//	}
-		//}
-		//return result;
+        decoded.reset();
+        return RC_Success;
     }
 
-    ResultCode OIV::LoadRaw(const OIV_CMD_LoadRaw_Request& loadRawRequest, int16_t& handle) 
+    ResultCode OIV::LoadRaw(const OIV_CMD_LoadRaw_Request& loadRawRequest, ImageHandle& handle) 
     {
-        using namespace IMCodec;
-        ImageItemSharedPtr imageItem = std::make_shared<ImageItem>();
-        ImageDescriptor& props = imageItem->descriptor;
-        props.height = loadRawRequest.height;
-        props.width = loadRawRequest.width;
-        props.texelFormatStorage = static_cast<IMCodec::TexelFormat>(loadRawRequest.texelFormat);
-        props.texelFormatDecompressed = static_cast<IMCodec::TexelFormat>(loadRawRequest.texelFormat);
-        props.rowPitchInBytes = loadRawRequest.rowPitch;
-        const size_t bufferSize = props.rowPitchInBytes * props.height;
-        imageItem->data.Allocate(bufferSize);
-        imageItem->data.Write(loadRawRequest.buffer, 0, bufferSize);
+        if (loadRawRequest.buffer == nullptr || loadRawRequest.rowPitch == 0 || loadRawRequest.height == 0)
+            return RC_InvalidParameters;
+
+        RawBufferParams params;
+        params.buffer = loadRawRequest.buffer;
+        params.width = loadRawRequest.width;
+        params.height = loadRawRequest.height;
+        params.rowPitch = loadRawRequest.rowPitch;
+        params.texelFormat = static_cast<IMCodec::TexelFormat>(loadRawRequest.texelFormat);
 
         IMUtil::AxisAlignedTransform transform{};
         //transform.rotation = static_cast<IMUtil::AxisAlignedRotation>(loadRawRequest.transformation);
         transform.flip = static_cast<IMUtil::AxisAlignedFlip>(loadRawRequest.transformation);
 
-        ImageSharedPtr image = std::make_shared<Image>(imageItem, ImageItemType::Unknown);
-        image = IMUtil::ImageUtil::Transform(transform, image);
-
-        handle = fImageManager.AddImage(image);
+        handle = fImageManager.AddImage(OIVRawImage::CreateImage(params, transform));
         return RC_Success;
-
-        
     }
 
-    IMCodec::ImageSharedPtr OIV::ApplyExifRotation(IMCodec::ImageSharedPtr image) const
+    IMCodec::ImageSharedPtr OIV::ApplyExifRotation(IMCodec::ImageSharedPtr image, unsigned short exifOrientation) const
     {
-        LL_EXCEPTION_NOT_IMPLEMENT("not implemented");
-        /*IMUtil::AxisAlignedTransform transform;
-        transform.rotation = static_cast<IMUtil::AxisAlignedRotation>(ResolveExifRotation(image->Get GetMetaData().exifData.orientation));
-        transform.flip = IMUtil::AxisAlignedFlip::None;
-        return IMUtil::ImageUtil::Transform(transform, image);*/
+        return IMUtil::ImageUtil::Transform(ResolveExifRotation(exifOrientation), image);
     }
 
-
-  
+    IMCodec::ImageLoader& OIV::GetImageLoader()
+    {
+        // Lazy initialize, loading the codec plugins is expensive and most clients decode images themselves.
+        if (fImageLoader == nullptr)
+            fImageLoader = std::make_unique<IMCodec::ImageLoader>();
+        return *fImageLoader;
+    }
 
 
     ResultCode OIV::CreateText(const OIV_CMD_CreateText_Request &request, OIV_CMD_CreateText_Response &response)
@@ -286,10 +462,17 @@ namespace OIV
             if (original != nullptr)
             {
                 bool rainbow = (req.flags & OIV_CF_RAINBOW_NORMALIZE) != 0;
+                const TexelFormat format = static_cast<TexelFormat>(req.format);
                 
-                ImageSharedPtr converted = IMUtil::ImageUtil::ConvertImageWithNormalization(original, static_cast<TexelFormat>(req.format), rainbow);
+                ImageSharedPtr converted = IMUtil::ImageUtil::ConvertImageWithNormalization(original, format, rainbow);
                 if (converted != nullptr)
-                    res.handle = fImageManager.AddImage(converted);
+                {
+                    res.handle = fImageManager.AddImage(converted, [this, source = req.handle, format, rainbow]() -> ImageSharedPtr
+                        {
+                            ImageSharedPtr original = fImageManager.GetImage(source);
+                            return original != nullptr ? IMUtil::ImageUtil::ConvertImageWithNormalization(original, format, rainbow) : nullptr;
+                        });
+                }
                 else
                     result = ResultCode::RC_BadConversion;
             }
@@ -327,6 +510,7 @@ namespace OIV
 
     ResultCode OIV::AddRenderable(IRenderable* renderable)
     {
+        fRenderables.insert(renderable);
         if (fRenderer != nullptr)
             fRenderer->AddRenderable(renderable);
         else
@@ -336,6 +520,7 @@ namespace OIV
     }
     ResultCode OIV::RemoveRenderable(IRenderable* renderable)
     {
+        fRenderables.erase(renderable);
         if (fRenderer != nullptr)
             fRenderer->RemoveRenderable(renderable);
         else
@@ -364,7 +549,11 @@ namespace OIV
 
             if (subImage != nullptr)
             {
-                ImageHandle handle = fImageManager.AddImage(subImage);
+                ImageHandle handle = fImageManager.AddImage(subImage, [this, source = request.imageHandle, cuttedRect]() -> IMCodec::ImageSharedPtr
+                    {
+                        IMCodec::ImageSharedPtr imageToCrop = fImageManager.GetImage(source);
+                        return imageToCrop != nullptr ? IMUtil::ImageUtil::GetSubImage(imageToCrop, cuttedRect) : nullptr;
+                    });
                 response.imageHandle = handle;
                 result = RC_Success;
             }
@@ -442,25 +631,78 @@ namespace OIV
 
     ResultCode OIV::GetSubImages(const OIV_CMD_GetSubImages_Request& req, OIV_CMD_GetSubImages_Response & res)
     {
-        return ResultCode::RC_NotImplemented;
-        // ImageManager::VecImageHandles children = fImageManager.GetChildrenOf(req.handle);
+        if (req.arraySize > 0 && req.childrenArray == nullptr)
+            return RC_InvalidParameters;
 
-        // //Copy no more then res.sizeOfArray elements-
-        // res.copiedElements = static_cast<uint32_t>(std::min<size_t>(req.arraySize, children.size()));
-        // memcpy(req.childrenArray, children.data(), res.copiedElements * sizeof(ImageHandle));
+        // The handles are returned without resolving them, an oriented sub-image is created when its handle is first used.
+        ImageManager::VecImageHandles children = fImageManager.GetChildrenOf(req.handle);
 
-        //return ResultCode::RC_Success;
+        //Copy no more then res.sizeOfArray elements-
+        res.copiedElements = static_cast<uint32_t>(std::min<size_t>(req.arraySize, children.size()));
+        std::copy_n(children.begin(), res.copiedElements, req.childrenArray);
+
+        return ResultCode::RC_Success;
     }
 
     ResultCode OIV::UnloadFile(const ImageHandle handle)
     {
-        return ResultCode::RC_NotImplemented;
+        uint32_t numUnloaded = 0;
+        UnloadFiles(&handle, 1, numUnloaded);
+        return numUnloaded == 1 ? RC_Success : RC_InvalidImageHandle;
+    }
+
+    ResultCode OIV::UnloadFiles(const ImageHandle* handles, uint32_t numHandles, uint32_t& numUnloaded)
+    {
+        if (numHandles > 0 && handles == nullptr)
+            return RC_InvalidParameters;
+
+        std::vector<IMCodec::ImageSharedPtr> removedImages;
+        numUnloaded = static_cast<uint32_t>(fImageManager.RemoveImages(handles, numHandles, removedImages));
+        if (removedImages.empty())
+            return RC_Success;
 
-        /*ResultCode result = RC_Success;
-        RemoveImageFromRenderer(handle);
-        fImageManager.RemoveImage(handle);
+        std::set<const IMCodec::Image*> removed;
+        for (const IMCodec::ImageSharedPtr& image : removedImages)
+            removed.insert(image.get());
 
-        return result;*/
+        // Removing a renderable from the renderer releases its texture.
+        std::vector<IRenderable*> renderables;
+        for (IRenderable* renderable : fRenderables)
+        {
+            if (removed.contains(renderable->GetImage().get()))
+                renderables.push_back(renderable);
+        }
+
+        for (IRenderable* renderable : renderables)
+            RemoveRenderable(renderable);
+
+        // Tiles are also resampled from the levels of the mip pyramids, drop them together with the pyramids.
+        std::set<const void*> tileSources(removed.begin(), removed.end());
+        {
+            std::lock_guard<std::mutex> lock(fMipPyramidsMutex);
+            for (auto it = fMipPyramids.begin(); it != fMipPyramids.end();)
+            {
+                if (removed.contains(it->first))
+                {
+                    if (it->second.pyramid != nullptr)
+                    {
+                        for (const IMCodec::ImageSharedPtr& level : it->second.pyramid->GetLevels())
+                            tileSources.insert(level.get());
+                    }
+                    it = fMipPyramids.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        fResampleTileCache.Remove(tileSources);
+
+        // Images not referenced by the client anymore are released here.
+        removedImages.clear();
+        return RC_Success;
     }
 
     int OIV::Init()
@@ -570,7 +812,11 @@ namespace OIV
             transform.rotation = static_cast<IMUtil::AxisAlignedRotation>(request.transform.rotation);
             transform.flip = static_cast<IMUtil::AxisAlignedFlip>(request.transform.flip);
             image = IMUtil::ImageUtil::Transform(transform,  image);
-            response.handle = fImageManager.AddImage(image);
+            response.handle = fImageManager.AddImage(image, [this, source = request.handle, transform]() -> IMCodec::ImageSharedPtr
+                {
+                    IMCodec::ImageSharedPtr image = fImageManager.GetImage(source);
+                    return image != nullptr ? IMUtil::ImageUtil::Transform(transform, image) : nullptr;
+                });
             return RC_Success;
         }
 
@@ -582,8 +828,140 @@ namespace OIV
         using namespace IMCodec;
         //resample the displayed image.
         ImageSharedPtr original = fImageManager.GetImage(resampleRequest.imageHandle);
-        ImageSharedPtr resmapled = Resample(original, resampleRequest.size);
-        handle = fImageManager.AddImage(resmapled);
+        if (original == nullptr)
+            return RC_InvalidImageHandle;
+
+        ResampleChannelType channelType;
+        uint8_t numChannels;
+        if (GetResamplerTexelLayout(original->GetTexelFormat(), channelType, numChannels) == false)
+            return RC_UnsupportedFormat;
+
+        if (IsValidResampleRegion(resampleRequest.region, resampleRequest.size) == false)
+            return RC_InvalidParameters;
+
+        ImageSharedPtr resmapled = Resample(original, resampleRequest.size, resampleRequest.filter, resampleRequest.region);
+        if (resmapled == nullptr)
+            return RC_UknownError;
+
+        handle = fImageManager.AddImage(resmapled, [this, resampleRequest]() -> ImageSharedPtr
+            {
+                ImageSharedPtr original = fImageManager.GetImage(resampleRequest.imageHandle);
+                return original != nullptr ? Resample(original, resampleRequest.size, resampleRequest.filter, resampleRequest.region) : nullptr;
+            });
+        return RC_Success;
+    }
+
+    std::shared_ptr<const MipPyramid> OIV::FindMipPyramid(const IMCodec::ImageSharedPtr& image)
+    {
+        std::lock_guard<std::mutex> lock(fMipPyramidsMutex);
+        auto it = fMipPyramids.find(image.get());
+        // The address may belong to a released image.
+        return it != fMipPyramids.end() && it->second.image.lock() == image ? it->second.pyramid : nullptr;
+    }
+
+    void OIV::BuildMipPyramid(IMCodec::ImageSharedPtr image, std::function<void()> onReady)
+    {
+        if (MipPyramid::IsSupported(image) == false || FindMipPyramid(image) != nullptr)
+            return;
+
+        const uint64_t generation = fMipPyramidGeneration;
+        fMipPyramidBuilder.Enqueue([this, generation, weakImage = std::weak_ptr<const IMCodec::Image>(image), onReady = std::move(onReady)]()
+            {
+                const ResampleCancellation cancellation{ &fMipPyramidGeneration, generation };
+                if (cancellation.IsCancelled())
+                    return;
+
+                // Don't hold the image while it's waiting, it might be closed meanwhile.
+                IMCodec::ImageSharedPtr image = std::const_pointer_cast<IMCodec::Image>(weakImage.lock());
+                if (image == nullptr || FindMipPyramid(image) != nullptr)
+                    return;
+
+                std::shared_ptr<const MipPyramid> pyramid;
+                try
+                {
+                    pyramid = MipPyramid::Create(image, SimdLevel::Best, &cancellation);
+                }
+                catch (...)
+                {
+                    // The pyramid is an optimization, resampling falls back to the full resolution image.
+                    return;
+                }
+
+                if (pyramid == nullptr)
+                    return;
+
+                {
+                    std::lock_guard<std::mutex> lock(fMipPyramidsMutex);
+                    std::erase_if(fMipPyramids, [](const auto& entry) { return entry.second.image.expired(); });
+                    fMipPyramids[image.get()] = MipPyramidEntry{ image, pyramid };
+                }
+
+                // The client may be gone once the builds are cancelled.
+                std::lock_guard<std::mutex> lock(fMipPyramidReadyMutex);
+                if (onReady != nullptr && cancellation.IsCancelled() == false)
+                    onReady();
+            });
+    }
+
+    void OIV::CancelMipPyramidBuilds()
+    {
+        fMipPyramidBuilder.ClearPendingJobs();
+        std::lock_guard<std::mutex> lock(fMipPyramidReadyMutex);
+        fMipPyramidGeneration++;
+    }
+
+    IMCodec::ImageSharedPtr OIV::GetMipLevel(IMCodec::ImageSharedPtr image, LLUtils::PointI32 minSize)
+    {
+        std::shared_ptr<const MipPyramid> pyramid = FindMipPyramid(image);
+        if (pyramid == nullptr || minSize.x <= 0 || minSize.y <= 0)
+            return nullptr;
+
+        return pyramid->FindLevel(static_cast<uint32_t>(minSize.x), static_cast<uint32_t>(minSize.y));
+    }
+
+    size_t OIV::GetMipPyramidSizeInBytes(IMCodec::ImageSharedPtr image)
+    {
+        std::shared_ptr<const MipPyramid> pyramid = FindMipPyramid(image);
+        return pyramid != nullptr ? pyramid->GetSizeInBytes() : 0;
+    }
+
+    ResultCode OIV::GetResamplerStatistics(OIV_CMD_GetResamplerStatistics_Response& res)
+    {
+        const ResampleTileCache::Statistics tileCache = fResampleTileCache.GetStatistics();
+        res.tileCacheHits = tileCache.hits;
+        res.tileCacheMisses = tileCache.misses;
+        res.tileCacheEvictions = tileCache.evictions;
+        res.tileCacheNumTiles = tileCache.numTiles;
+        res.tileCacheSizeInBytes = tileCache.sizeInBytes;
+        res.tileCacheBudgetInBytes = tileCache.budgetInBytes;
+
+        const ResamplerStatistics resampler = fResampler.GetStatistics();
+        res.cancelledJobs = resampler.cancelledJobs;
+        res.cancelledRows = resampler.skippedRows;
+        res.jobs = resampler.jobs;
+        res.chunks = resampler.chunks;
+        res.busyTimeNs = resampler.busyTimeNs;
+        res.maxThreadBusyTimeNs = resampler.maxThreadBusyTimeNs;
+        res.threads = resampler.threads;
+        return RC_Success;
+    }
+
+    ResultCode OIV::SetImageMemoryBudget(const OIV_CMD_SetImageMemoryBudget_Request& req)
+    {
+        fImageManager.SetBudget(static_cast<size_t>(req.budgetInBytes));
+        return RC_Success;
+    }
+
+    ResultCode OIV::GetImageMemoryStatistics(OIV_CMD_GetImageMemoryStatistics_Response& res)
+    {
+        const ImageManager::Statistics statistics = fImageManager.GetStatistics();
+        res.numImages = statistics.numImages;
+        res.numEvictedImages = statistics.numEvictedImages;
+        res.sizeInBytes = statistics.sizeInBytes;
+        res.peakSizeInBytes = statistics.peakSizeInBytes;
+        res.budgetInBytes = statistics.budgetInBytes;
+        res.evictions = statistics.evictions;
+        res.recreations = statistics.recreations;
         return RC_Success;
     }
 
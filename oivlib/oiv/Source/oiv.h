@@ -3,8 +3,13 @@
 #include <Interfaces/IRenderer.h>
 #include "ImageManager.h"
 #include "Resampler.h"
+#include "ResampleTileCache.h"
+#include "MipPyramid.h"
+#include "ThreadPool.h"
+#include <mutex>
 #include <set>
 #include <ImageUtil/AxisAlignedTransform.h>
+#include <ImageLoader.h>
 
 
 namespace OIV
@@ -14,10 +19,13 @@ namespace OIV
 
 
         public:
+        ~OIV();
+
 #pragma region //-------------IPictureListener implementation------------------
         ResultCode UnloadFile(const ImageHandle handle) override;
+        ResultCode UnloadFiles(const ImageHandle* handles, uint32_t numHandles, uint32_t& numUnloaded) override;
         ResultCode LoadFile(void* buffer, std::size_t size, char* extension , OIV_CMD_LoadFile_Flags flags, ImageHandle& handle) override;
-        ResultCode LoadRaw(const OIV_CMD_LoadRaw_Request& loadRawRequest, int16_t& handle) override;
+        ResultCode LoadRaw(const OIV_CMD_LoadRaw_Request& loadRawRequest, ImageHandle& handle) override;
         //ResultCode DisplayFile(const OIV_CMD_DisplayImage_Request& display_flags) override;
         ResultCode CreateText(const OIV_CMD_CreateText_Request&, OIV_CMD_CreateText_Response&) override;
         ResultCode SetSelectionRect(const OIV_CMD_SetSelectionRect_Request& selectionRect) override;
@@ -30,6 +38,9 @@ namespace OIV
         ResultCode GetTexelInfo(const OIV_CMD_TexelInfo_Request& texel_request, OIV_CMD_TexelInfo_Response& texelresponse) override;
         ResultCode GetKnownFileTypes(OIV_CMD_GetKnownFileTypes_Response& res) override;
         ResultCode ResampleImage(const OIV_CMD_Resample_Request& resampleRequest, ImageHandle& handle) override;
+        ResultCode GetResamplerStatistics(OIV_CMD_GetResamplerStatistics_Response& res) override;
+        ResultCode SetImageMemoryBudget(const OIV_CMD_SetImageMemoryBudget_Request& req) override;
+        ResultCode GetImageMemoryStatistics(OIV_CMD_GetImageMemoryStatistics_Response& res) override;
         ResultCode RegisterCallbacks(const OIV_CMD_RegisterCallbacks_Request& callbacks) override;
         ResultCode GetSubImages(const OIV_CMD_GetSubImages_Request& request, OIV_CMD_GetSubImages_Response& res) override;
         IRenderer* GetRenderer() override;
@@ -44,16 +55,24 @@ namespace OIV
         int SetTexelGrid(const CmdRequestTexelGrid& viewParams) override;
         int SetClientSize(uint16_t width, uint16_t height) override;
         ResultCode AxisAlignTrasnform(const OIV_CMD_AxisAlignedTransform_Request& request, OIV_CMD_AxisAlignedTransform_Response& response) override;
-        IMCodec::ImageSharedPtr Resample(IMCodec::ImageSharedPtr sourceImage, LLUtils::PointI32 targetSize) override;
+        IMCodec::ImageSharedPtr Resample(IMCodec::ImageSharedPtr sourceImage, LLUtils::PointI32 targetSize, OIV_Resample_Filter filter, const OIV_RECT_I& targetRegion, const ResampleCancellation* cancellation = nullptr) override;
+        void BuildMipPyramid(IMCodec::ImageSharedPtr image, std::function<void()> onReady) override;
+        void CancelMipPyramidBuilds() override;
+        IMCodec::ImageSharedPtr GetMipLevel(IMCodec::ImageSharedPtr image, LLUtils::PointI32 minSize) override;
+        size_t GetMipPyramidSizeInBytes(IMCodec::ImageSharedPtr image) override;
 #pragma endregion
 
 #pragma region //-------------Private methods------------------
         IRendererSharedPtr CreateBestRenderer();
         bool IsImageDisplayed() const;
         void UpdateGpuParams();
-        IMUtil::AxisAlignedRotation ResolveExifRotation(unsigned short exifRotation) const;
-        IMCodec::ImageSharedPtr ApplyExifRotation(IMCodec::ImageSharedPtr image) const;
+        IMUtil::AxisAlignedTransform ResolveExifRotation(unsigned short exifRotation) const;
+        bool GetResamplerTexelLayout(IMCodec::TexelFormat texelFormat, ResampleChannelType& channelType, uint8_t& numChannels) const;
+        static bool IsValidResampleRegion(const OIV_RECT_I& targetRegion, LLUtils::PointI32 targetSize);
+        IMCodec::ImageSharedPtr ApplyExifRotation(IMCodec::ImageSharedPtr image, unsigned short exifOrientation) const;
+        IMCodec::ImageLoader& GetImageLoader();
         IMCodec::ImageSharedPtr GetDisplayImage() const;
+        std::shared_ptr<const MipPyramid> FindMipPyramid(const IMCodec::ImageSharedPtr& image);
         void RefreshRenderer();
         LLUtils::PointI32 GetClientSize() const;
 #pragma endregion
@@ -93,7 +112,8 @@ namespace OIV
         
         OIV_PROP_TransparencyMode fTransparencyShade = OIV_PROP_TransparencyMode::TM_Medium;
         std::set<IRenderable*> fImagesUploadToRenderer;
-        ImageManager fImageManager;
+        // Resolving the handle of an evicted image recreates it.
+        mutable ImageManager fImageManager;
         std::map<ImageHandle, std::vector<ImageHandle>> fImageToChildren;
         IRendererSharedPtr fRenderer = nullptr;
         ViewParameters fViewParams = {};
@@ -101,8 +121,23 @@ namespace OIV
         bool fShowGrid = false;
         LLUtils::PointI32 fClientSize = LLUtils::PointI32::Zero;
         OIV_CMD_RegisterCallbacks_Request fCallBacks = {};
+        std::unique_ptr<IMCodec::ImageLoader> fImageLoader;
         Resampler fResampler;
+        ResampleTileCache fResampleTileCache;
         std::vector<IRenderable*> fPendingRenderables;
+        std::set<IRenderable*> fRenderables; // Added renderables, including the pending ones.
+        struct MipPyramidEntry
+        {
+            std::weak_ptr<const IMCodec::Image> image;
+            std::shared_ptr<const MipPyramid> pyramid;
+        };
+        std::map<const IMCodec::Image*, MipPyramidEntry> fMipPyramids;
+        std::mutex fMipPyramidsMutex;
+        std::atomic_uint64_t fMipPyramidGeneration{};
+        // Held while a build invokes its 'onReady', so a cancellation waits for it.
+        std::mutex fMipPyramidReadyMutex;
+        // Declared last, so pending builds are done before the pyramids they are stored in are destroyed.
+        ThreadPool fMipPyramidBuilder{ 1 };
 #pragma endregion
     };
 }